@@ -0,0 +1,284 @@
+#include "../src/engine/Engine.h"
+#include "../src/engine/Transform.h"
+#include "../src/engine/TransformArray.h"
+#include "../src/engine/Macros.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+using namespace RG3GE;
+
+/**
+ * Renders a fixed set of scenes for a fixed number of frames and prints one JSON object per scene (stdout).
+ *
+ * Usage: bench.main [--frames N] [--warmup N] [--count N] [--scene NAME] [--software] [--window]
+ *  --software = use Mesa's llvmpipe (for machines without a GPU)
+ *  --window   = render into a visible window (with vsync) instead of offscreen
+ *
+ * Every scene uses the same seed and animates by frame number (not deltaTime),
+ * so every run submits exactly the same jobs.
+ */
+
+#define BENCH_WIDTH 640
+#define BENCH_HEIGHT 480
+#define BENCH_TEXTURE "./assets/ship.png"
+
+struct BenchScene {
+    const char* name;
+    std::function<void(Engine*, int count)> setup;
+    std::function<void(Engine*, int count, int frame)> frame;
+    std::function<void(Engine*)> teardown;
+};
+
+/** Small LCG, so the scenes do not depend on the std library implementation */
+static uint32_t _seed;
+static uint32_t _random() {
+    _seed = _seed * 1664525u + 1013904223u;
+    return _seed >> 8;
+}
+static float _randomf(float max) {
+    return (float)(_random() % 65536) / 65536.0f * max;
+}
+
+static std::vector<Transform> _transforms;
+static TransformArray _transform_array;
+static std::vector<Texture> _textures;
+static std::vector<Shape2D> _shapes;
+
+static void _createTransforms(int count) {
+    _transforms.clear();
+    for (int i = 0; i < count; i++)
+        _transforms.push_back({{_randomf(BENCH_WIDTH), _randomf(BENCH_HEIGHT)}, {16}, {0.5f + _randomf(1.0f)}, _randomf(360.0f)});
+}
+
+static void _destroyTextures(Engine* game) {
+    for (auto& t : _textures) game->TextureDestroy(t);
+    _textures.clear();
+    game->TextureCacheEvictUnused();
+}
+
+static std::vector<BenchScene> _scenes = {
+    {"sprites_one_texture",
+     [](Engine* game, int count) {
+         _createTransforms(count);
+         _textures.push_back(game->TextureLoad(BENCH_TEXTURE));
+         game->TextureChangeCrop(_textures[0], 0, 0, 32, 32);
+     },
+     [](Engine* game, int count, int frame) {
+         for (int i = 0; i < count; i++) {
+             _transforms[i].rotation += 1.0;
+             game->SubmitForRender(_textures[0], _transforms[i], (float)(i % 64) / 64.0f);
+         }
+     },
+     _destroyTextures},
+
+    // Same as sprites_one_texture, but updated and submitted in bulk (one zLayer for all)
+    {"sprites_transform_array",
+     [](Engine* game, int count) {
+         _createTransforms(count);
+         _transform_array.clear();
+         for (auto& t : _transforms) _transform_array.add(t);
+         _textures.push_back(game->TextureLoad(BENCH_TEXTURE));
+         game->TextureChangeCrop(_textures[0], 0, 0, 32, 32);
+     },
+     [](Engine* game, int count, int frame) {
+         _transform_array.rotate(1.0f);
+         _transform_array.updateDirections();
+         game->SubmitForRender(_textures[0], _transform_array);
+     },
+     _destroyTextures},
+
+    // 64 separately loaded copies of the file (evicted from the texture cache after every load,
+    // otherwise all of them would share one slot)
+    {"sprites_many_textures",
+     [](Engine* game, int count) {
+         _createTransforms(count);
+         for (int i = 0; i < 64; i++) {
+             _textures.push_back(game->TextureLoad(BENCH_TEXTURE));
+             game->TextureCacheEvict(BENCH_TEXTURE);
+             game->TextureChangeCrop(_textures[i], (i % 2) * 32, ((i / 2) % 4) * 32, 32, 32);
+         }
+     },
+     [](Engine* game, int count, int frame) {
+         for (int i = 0; i < count; i++) {
+             _transforms[i].rotation += 1.0;
+             game->SubmitForRender(_textures[i % _textures.size()], _transforms[i], (float)(i % 64) / 64.0f);
+         }
+     },
+     _destroyTextures},
+
+    {"shapes",
+     [](Engine* game, int count) {
+         _createTransforms(count);
+         for (int i = 0; i < count; i++) {
+             int corners = 3 + (int)(_random() % 6);
+             std::vector<Vertex2D> verts;
+             verts.push_back(Vertex2D(16, 16, Color((int)(_random() % 256), (int)(_random() % 256), (int)(_random() % 256), 255)));
+             for (int c = 0; c <= corners; c++) {
+                 float a = (float)c / (float)corners * (float)PI2;
+                 verts.push_back(Vertex2D(16 + cosf(a) * 16, 16 + sinf(a) * 16, (int)(_random() % 256), (int)(_random() % 256), (int)(_random() % 256), 255));
+             }
+             _shapes.push_back(game->CreateShape2D(PolyShapes::TRIANGLE_FAN, verts));
+         }
+     },
+     [](Engine* game, int count, int frame) {
+         for (int i = 0; i < count; i++) {
+             _transforms[i].rotation -= 1.0;
+             game->SubmitForRender(_shapes[i], _transforms[i], (float)(i % 64) / 64.0f);
+         }
+     },
+     [](Engine* game) {
+         for (auto& s : _shapes) game->DestroyShape2D(s);
+         _shapes.clear();
+     }},
+
+    {"primitives",
+     [](Engine* game, int count) { _createTransforms(count); },
+     [](Engine* game, int count, int frame) {
+         Color c = Color(255, 160, 32, 255);
+         for (int i = 0; i < count; i++) {
+             Transform& t = _transforms[i];
+             int x = (int)t.position.x, y = (int)t.position.y;
+             switch (i % 4) {
+                 case 0:
+                 case 1:
+                     game->DrawPixel((x + frame) % BENCH_WIDTH, y, c);
+                     break;
+                 case 2:
+                     game->DrawLine(x, y, (x + frame * 3) % BENCH_WIDTH, BENCH_HEIGHT - y, c, 1 + i % 3);
+                     break;
+                 case 3:
+                     game->DrawRectFilled(x, y, 8, 8, c);
+                     break;
+             }
+         }
+     },
+     [](Engine* game) {}},
+
+    // Loads and destroys a texture count/64 times per frame (TextureLoad / atlas / slot reuse)
+    {"texture_churn",
+     [](Engine* game, int count) { _createTransforms(1); },
+     [](Engine* game, int count, int frame) {
+         int loads = std::max(1, count / 64);
+         for (int i = 0; i < loads; i++) {
+             Texture t = game->TextureLoad(BENCH_TEXTURE);
+             if (i == loads - 1) game->SubmitForRender(t, _transforms[0]);
+             game->TextureDestroy(t);
+             game->TextureCacheEvict(BENCH_TEXTURE);  // read the file every time
+         }
+     },
+     [](Engine* game) {}},
+};
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    int warmup = 30;
+    int count = 2000;
+    const char* only = nullptr;
+    EngineFlags flags = EngineFlags::HEADLESS;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+            warmup = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--count") && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--scene") && i + 1 < argc)
+            only = argv[++i];
+        else if (!strcmp(argv[i], "--software"))
+            flags = flags | EngineFlags::SOFTWARE_RENDERER;
+        else if (!strcmp(argv[i], "--window"))
+            flags = static_cast<EngineFlags>(static_cast<unsigned int>(flags) & ~static_cast<unsigned int>(EngineFlags::HEADLESS));
+        else {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (frames <= 0 || count <= 0) {
+        fprintf(stderr, "--frames and --count must be greater than 0\n");
+        return 1;
+    }
+
+    Engine* game = Engine::init(BENCH_WIDTH, BENCH_HEIGHT, "RG3GE::Engine bench", flags);
+    if (!game) {
+        fprintf(stderr, "could not initialize the engine\n");
+        Engine::cleanup();
+        return 1;
+    }
+
+    fprintf(stdout, "{\"renderer\":\"%s\",\"version\":\"%s\",\"frames\":%d,\"count\":%d}\n",
+            (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION), frames, count);
+
+    int failed = 0;
+
+    for (auto& scene : _scenes) {
+        if (only && strcmp(only, scene.name)) continue;
+
+        _seed = 12345;
+        scene.setup(game, count);
+
+        std::vector<double> frameTimes;
+        frameTimes.reserve(frames);
+        uint64_t jobs = 0;
+        uint64_t drawCalls = 0;
+
+        Uint64 freq = SDL_GetPerformanceFrequency();
+        Uint64 last = 0;
+        Uint64 start = 0;
+
+        // windowTick draws, what was submitted before it, so frame i is measured from tick i-1 to tick i
+        for (int f = 0; f <= warmup + frames; f++) {
+            if (!game->windowTick()) break;
+            glFinish();  // include the GPU work of the frame
+
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (f > warmup) {
+                frameTimes.push_back((double)(now - last) * 1000.0 / (double)freq);
+                FrameStats stats = game->frameStats();
+                jobs += stats.jobs;
+                drawCalls += stats.drawCalls;
+            } else if (f == warmup)
+                start = now;
+            last = now;
+
+            if (f == warmup + frames) break;
+
+            game->ClearScreen(Engine::BLACK);
+            scene.frame(game, count, f);
+        }
+
+        scene.teardown(game);
+
+        if ((int)frameTimes.size() != frames) {
+            fprintf(stdout, "{\"scene\":\"%s\",\"error\":\"window was closed after %d frames\"}\n", scene.name, (int)frameTimes.size());
+            failed++;
+            break;
+        }
+
+        double seconds = (double)(last - start) / (double)freq;
+        std::sort(frameTimes.begin(), frameTimes.end());
+
+        fprintf(stdout,
+                "{\"scene\":\"%s\",\"count\":%d,\"frames\":%d,\"fps\":%.2f,\"jobs_per_sec\":%.0f,"
+                "\"draw_calls_per_frame\":%.1f,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+                scene.name, count, frames,
+                (double)frames / seconds,
+                (double)jobs / seconds,
+                (double)drawCalls / (double)frames,
+                frameTimes[frames / 2],
+                frameTimes[std::min(frames - 1, (int)(frames * 0.99))],
+                frameTimes.back());
+        fflush(stdout);
+    }
+
+    Engine::cleanup();
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#include "../src/engine/Engine.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace RG3GE;
+
+/**
+ * Runs engine checks, that need a real OpenGL context (offscreen), prints one line per check
+ * and returns 1, if any of them failed.
+ *
+ * Usage: check.main [--software]
+ *  --software = use Mesa's llvmpipe (for machines without a GPU)
+ */
+
+#define CHECK_TEXTURE "./assets/ship.png"
+
+struct Check {
+    const char* name;
+    std::function<bool(Engine*)> run;
+};
+
+static std::vector<Check> _checks = {
+    // A failed TextureLoadAsync must not stay in the texture cache:
+    // loads a truncated copy of CHECK_TEXTURE, then the real file under the same path
+    {"texture_retry_after_failed_load",
+     [](Engine* game) {
+         namespace fs = std::filesystem;
+         std::error_code error;
+         fs::path path = fs::temp_directory_path(error) / "rg3ge_check_retry.png";
+         std::string file = path.string();
+
+         // The header is still intact (TextureLoadAsync accepts it), the pixels are missing
+         fs::copy_file(CHECK_TEXTURE, path, fs::copy_options::overwrite_existing, error);
+         fs::resize_file(path, 64, error);
+
+         Texture bad = game->TextureLoadAsync(file.c_str());
+         TextureLoadState badState = game->TextureWait(bad);
+         game->TextureDestroy(bad);
+
+         fs::copy_file(CHECK_TEXTURE, path, fs::copy_options::overwrite_existing, error);
+
+         Texture good = game->TextureLoadAsync(file.c_str());
+         TextureLoadState goodState = game->TextureWait(good);
+         Texture sync = game->TextureLoad(file.c_str());
+
+         bool ok = !error && badState == TextureLoadState::FAILED && goodState == TextureLoadState::READY &&
+                   sync.slot == good.slot && game->TextureStatus(sync) == TextureLoadState::READY;
+
+         game->TextureDestroy(good);
+         game->TextureDestroy(sync);
+         game->TextureCacheEvict(file.c_str());
+         fs::remove(path, error);
+         return ok;
+     }},
+};
+
+int main(int argc, char** argv) {
+    EngineFlags flags = EngineFlags::HEADLESS;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--software")
+            flags = flags | EngineFlags::SOFTWARE_RENDERER;
+        else {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Engine* game = Engine::init(64, 64, "RG3GE::Engine check", flags);
+    if (!game) {
+        fprintf(stderr, "could not initialize the engine\n");
+        Engine::cleanup();
+        return 1;
+    }
+
+    int failed = 0;
+    for (auto& c : _checks) {
+        bool ok = c.run(game);
+        fprintf(stdout, "%s %s\n", ok ? "ok  " : "FAIL", c.name);
+        if (!ok) failed++;
+    }
+
+    Engine::cleanup();
+
+    fprintf(stdout, "%d of %d checks failed\n", failed, (int)_checks.size());
+    return failed ? 1 : 0;
+}
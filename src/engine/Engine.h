@@ -4,6 +4,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_video.h>
 #include <functional>
+#include <span>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -14,6 +15,9 @@
 namespace RG3GE {
 
 	struct Transform;
+	class TransformArray;
+	struct TextureSlot;
+	struct TextureLoadJob;
 
 	/**
 	 * Defines how Shape2D Objects are draw.
@@ -31,13 +35,53 @@ namespace RG3GE {
 		POLYGON = GL_POLYGON
 	};
 
+	/**
+	 * Optional Engine features, that can be selected via Engine::init (combine them with | ).
+	 */
+	enum class EngineFlags : unsigned int {
+		NONE = 0,
+
+		/** Creates an OpenGL 3.3 core profile context instead of a compatibility one.
+		 *  (QUADS, QUAD_STRIP and POLYGON shapes are then drawn as indexed triangles) */
+		CORE_PROFILE = 1 << 0,
+
+		/** Moves the OpenGL context to a thread of its own. RenderAll() then only hands the frame over
+		 *  and returns, so the next frame can be build, while the last one is drawn.
+		 *  (Create/Load calls wait for the render thread, Destroy and ClearScreen are recorded into the frame) */
+		RENDER_THREAD = 1 << 1,
+
+		/** Renders into an offscreen framebuffer on a hidden window (or SDLs offscreen driver, if there is no
+		 *  display server), without vsync. Use CaptureFrame to get the result. */
+		HEADLESS = 1 << 2,
+
+		/** Asks Mesa for its llvmpipe software renderer (for machines without a GPU) */
+		SOFTWARE_RENDERER = 1 << 3
+	};
+	inline EngineFlags operator | (EngineFlags a, EngineFlags b) { return static_cast<EngineFlags>(static_cast<unsigned int>(a) | static_cast<unsigned int>(b)); }
+	inline bool operator & (EngineFlags a, EngineFlags b) { return (static_cast<unsigned int>(a) & static_cast<unsigned int>(b)) != 0; }
+
+	/**
+	 * How the vertices of a Shape2D are stored in VRAM.
+	 */
+	enum class VertexFormat {
+		FLOAT,  // Vertex2D (32 bytes)
+		PACKED  // PackedVertex2D (16 bytes)
+	};
+
 	/**
 	 * Vector based graphic constructs , that are stored in VRAM.
+	 * The vertices are a range inside one of the Engines shared vertex buffers.
 	 */
 	struct Shape2D {
 		RG3GE::PolyShapes shape;
+		RG3GE::VertexFormat format;
 		int vertexCnt;
+		int firstVertex;
 		unsigned int vertexBuffer;
+		unsigned int vertexArray;
+
+		/** Handle of the shape inside the engine. -1 = no shape */
+		int id;
 
 		Shape2D();
 	};
@@ -63,8 +107,8 @@ namespace RG3GE {
 		operator Vec2<double>() { return Vec2<double>{ static_cast<double>(x), static_cast<double>(y) }; }
 		operator Vec2<int>() { return Vec2<int>{ static_cast<int>(x), static_cast<int>(y) }; }
 
-		Vec2<T>(T x, T y) { this->x = x; this->y = y; };
-		Vec2<T>(T v = 0) { this->x = v; this->y = v; };
+		Vec2(T x, T y) { this->x = x; this->y = y; };
+		Vec2(T v = 0) { this->x = v; this->y = v; };
 
 		void fillArray(T arr[2]) {
 			arr[0] = this->x;
@@ -98,26 +142,60 @@ namespace RG3GE {
 		Vertex2D(float x, float y, float u, float v);
 	};
 
+	/**
+	 * Same as Vertex2D, but only takes half the VRAM (for shapes with lots of vertices).
+	 * The color has 8 bits per channel and the uv coordinates are stored as 16 bit fractions (0 - 1).
+	 */
+	struct PackedVertex2D {
+		Vec2<float> position;
+		unsigned char r, g, b, a;
+		unsigned short u, v;
+
+		PackedVertex2D();
+		PackedVertex2D(float x, float y);
+		PackedVertex2D(float x, float y, int r, int g, int b, int a);
+		PackedVertex2D(float x, float y, Color c);
+		PackedVertex2D(float x, float y, float u, float v);
+		PackedVertex2D(const Vertex2D& vertex);
+	};
+
 	struct Texture {
 		Vec2<float> cropSize;
         Vec2<float> uvOffset;
+
+		/** Handle of the texture slot (index + generation). -1 = no texture */
 		int slot;
 	};
 
+	/** See Engine::TextureLoadAsync */
+	enum class TextureLoadState : unsigned char {
+		LOADING,  // drawn as a placeholder
+		READY,
+		FAILED    // stays a placeholder, until it is destroyed
+	};
+
+	/**
+	 * Pixels, that live in RAM and can be changed directly (see Engine::CanvasCreate).
+	 * Only the changed area is copied to VRAM, before the next frame is drawn.
+	 */
+	struct Canvas {
+		int width, height;
+
+		/** Submit it via SubmitForRender, like any other Texture (do not destroy it via TextureDestroy) */
+		Texture texture;
+
+		/** Handle of the canvas inside the engine. -1 = no canvas */
+		int id;
+	};
+
     struct Shader {
         int u_shader_mode;
 
         int u_screen;
-        
-        int u_translation;
-        int u_origin;
-        int u_zlayer;
-        int u_angle;
-        int u_scale;
 
-        int u_textureCrop;
+        int u_transforms;
+        int u_job;
 
-        int u_drawcolor;
         int u_texture;
 
         int a_position;
@@ -125,6 +203,28 @@ namespace RG3GE {
         int a_uvCoords;
     };
 
+	/**
+	 * What the last RenderAll() did (see Engine::frameStats)
+	 */
+	struct FrameStats {
+		unsigned int jobs = 0;           // submitted via SubmitForRender / Draw... functions
+		unsigned int culled = 0;         // jobs, that were outside the window
+		unsigned int drawCalls = 0;
+		unsigned int textureBinds = 0;
+		unsigned int uniformUpdates = 0;
+		unsigned int vertices = 0;       // over all instances
+		double gpuTime = -1.0;           // in milliseconds, measured two frames earlier (-1 = not available yet)
+	};
+
+	/** See Engine::textureCacheStats */
+	struct TextureCacheStats {
+		unsigned int hits = 0;      // TextureLoad / TextureLoadAsync calls, that got a texture from the cache
+		unsigned int misses = 0;    // calls, that had to read the file
+		unsigned int textures = 0;  // currently in the cache
+		unsigned int unused = 0;    // in the cache, but without any handle (see TextureCacheEvictUnused)
+		size_t bytes = 0;           // pixels of the cached textures (4 bytes each)
+	};
+
 	/**
 	 * Heartpiece of the the Engine.
 	 */
@@ -163,6 +263,19 @@ namespace RG3GE {
 			std::function<bool(const Engine*)> onBuild = [](const Engine* e) {return true; }
 		);
 
+		/**
+		 * \brief Same as above, but allows to select optional Engine features
+		 *
+		 * \param flags - see EngineFlags (for example EngineFlags::CORE_PROFILE)
+		 */
+		static Engine* init(
+			int winWidth, int winHeight,
+			const char* winTitle,
+			EngineFlags flags,
+			unsigned int sdl_init_flags = 0,
+			std::function<bool(const Engine*)> onBuild = [](const Engine* e) {return true; }
+		);
+
 		/**
 		 * \brief Destorys all still running instances of engine and shuts down
 		 *		SDL2
@@ -191,6 +304,7 @@ namespace RG3GE {
 
 		/**
 		 * Multiplys the given output Color to what ever is rendered on the screen
+		 * (the tint is tracked per thread, it only affects jobs submitted by the calling thread)
 		 * \param c
 		 */
 		void SetTint(Color c);
@@ -206,11 +320,37 @@ namespace RG3GE {
 		Shape2D CreateShape2D(PolyShapes shape, int verts, const Vertex2D vertices[]);
 		Shape2D CreateShape2D(PolyShapes shape, const std::vector<Vertex2D>& data);
 
+		/** \brief Same as above, but the shape uses the smaller VertexFormat::PACKED */
+		Shape2D CreateShape2D(PolyShapes shape, int verts, const PackedVertex2D vertices[]);
+		Shape2D CreateShape2D(PolyShapes shape, std::span<const PackedVertex2D> data);
+
 		/** \Shapes created via CreateShape2D need to be destory, (to free the Graphics Card)
 		 */
 		void DestroyShape2D(Shape2D);
 
+		/**
+		 * \brief Replaces all vertices of the shape (the number of vertices can change)
+		 *
+		 * The first update moves the shape into a vertex buffer of its own. From then on every
+		 * full update orphans that buffer, so it never waits for frames, that are still drawn.
+		 *
+		 * \return - false if the shape was not created via CreateShape2D or is already destroyed
+		 */
+		bool UpdateShape2D(Shape2D& shape, std::span<const Vertex2D> vertices);
+
+		/**
+		 * \brief Overwrites the vertices starting at firstVertex (the range has to be inside the shape)
+		 *
+		 * \return - false if the shape is invalid or the range is outside of it
+		 */
+		bool UpdateShape2D(Shape2D& shape, int firstVertex, std::span<const Vertex2D> vertices);
+
+		/** \brief Same as above, for shapes, that were created from PackedVertex2D */
+		bool UpdateShape2D(Shape2D& shape, std::span<const PackedVertex2D> vertices);
+		bool UpdateShape2D(Shape2D& shape, int firstVertex, std::span<const PackedVertex2D> vertices);
+
 		// Basic Draw Functions
+		// (everything drawn on the same zLayer during a frame is collected and drawn with a single draw call)
 		void DrawPixel(int x, int y, Color c, float zLayer = 0);
 		void DrawRectFilled(int x, int y, int w, int h, Color c, float zLayer = 0);
 		void DrawLine(int startx, int starty, int endx, int endy, Color c, int tickness = 1, float zLayer = 0);
@@ -220,6 +360,8 @@ namespace RG3GE {
 		 *============================================================================*/
 		/**
 		 * Loads a Texture from a File (supported tested file type(s) is/are .png .
+		 * Files are only read once. Loading the same path again returns the cached texture
+		 * (it shares the VRAM like a TextureClone).
 		 * 
 		 * \param filename - filename relative to the .executeable
 		 * 
@@ -227,24 +369,120 @@ namespace RG3GE {
 		 */
 		Texture TextureLoad(const char* filename);
 
-		/** Loaded textures need to be destroyed, (to free Up VRAM) */
+		/**
+		 * Loaded textures need to be destroyed, (to free Up VRAM)
+		 * The last handle of a file keeps its texture in the cache, as long as all of those unused
+		 * textures fit into ENGINE_TEXTURE_CACHE_BYTES (the least recently loaded ones are freed first).
+		 */
 		void    TextureDestroy(Texture& t);
+
+		/** Frees all cached textures, that are no longer used by any handle */
+		void TextureCacheEvictUnused();
+
+		/**
+		 * Removes the file from the cache. The next TextureLoad reads it again.
+		 * Handles, that still use the texture, keep working (it is freed with the last of them).
+		 */
+		void TextureCacheEvict(const char* filename);
+
+		TextureCacheStats textureCacheStats();
+
+		/**
+		 * Loads a Texture in the background and returns right away. The file is decoded by a worker thread
+		 * and copied to VRAM over the next frames (a few MB per RenderAll, see engine_config.h).
+		 * Until then the Texture is drawn as a placeholder of the same size. It can already be
+		 * submitted, cropped, cloned and destroyed like any other Texture.
+		 *
+		 * \return - the Resource-Handle for the texture (slot is -1, if the file is not a readable image)
+		 */
+		Texture TextureLoadAsync(const char* filename);
+
+		TextureLoadState TextureStatus(const Texture& t);
+
+		/** Blocks until the texture has finished loading (the rest of it is uploaded right away) */
+		TextureLoadState TextureWait(const Texture& t);
 		
+		/**
+		 * Queues a Texture or Shape2D for the next RenderAll().
+		 * Can be called from multiple threads at once (each thread records into its own buffer),
+		 * but not while RenderAll() runs or while Shapes/Textures get created or destroyed.
+		 */
 		void SubmitForRender(Texture&, Transform&, float zLayer = 0);
 		void SubmitForRender(Shape2D&, Transform&, float zLayer = 0);
 
+		/** Queues one job per entry of the array (all on the same zLayer, with the current tint) */
+		void SubmitForRender(Texture&, TransformArray&, float zLayer = 0);
+		void SubmitForRender(Shape2D&, TransformArray&, float zLayer = 0);
+
+		/** Merges the jobs of all threads, sorts them and draws them */
 		void RenderAll();
 
+		/**
+		 * \return - the number of batches (draw calls), that the last RenderAll() needed
+		 *           to output all submitted jobs
+		 */
+		unsigned int batchCount();
+
+		/** \return - the number of jobs, that the last RenderAll() skipped, because they were outside the window */
+		unsigned int culledCount();
+
+		/**
+		 * \return - the statistics of the last drawn frame. The GPU time comes from timer queries,
+		 *           that are read two frames later, so reading them never waits for the GPU.
+		 */
+		FrameStats frameStats();
+
+		/**
+		 * Opaque jobs (Textures without transparent pixels / Shapes without transparent vertex colors,
+		 * submitted with a tint alpha of 1) are drawn front to back with blending turned off,
+		 * so the depth buffer can reject what is hidden behind them. Only the rest is drawn back to front.
+		 * (enabled by default, takes effect for jobs submitted after the call)
+		 */
+		void SetOpaquePass(bool enable);
+
 		void	TextureChangeCrop(Texture& t, int x, int y, int w, int h);
 
 		Texture TextureClone(Texture& src);
 
+		/*==============================================================================
+		 * Canvas related functions
+		 *============================================================================*/
+		/**
+		 * Creates a canvas of the given size, filled with the given color.
+		 *
+		 * \return - the canvas (id is -1, if it could not be created)
+		 */
+		Canvas CanvasCreate(int width, int height, Color clear = { 0.0f, 0.0f, 0.0f, 0.0f });
+
+		/** Frees the pixels and the texture of the canvas */
+		void CanvasDestroy(Canvas& canvas);
+
+		// Everything outside of the canvas is ignored
+		void CanvasSetPixel(Canvas& canvas, int x, int y, Color c);
+		void CanvasFill(Canvas& canvas, int x, int y, int w, int h, Color c);
+		void CanvasClear(Canvas& canvas, Color c);
+
+		/**
+		 * Copies pixels into the canvas.
+		 *
+		 * \param rgba - w * h pixels, 4 bytes each (r, g, b, a), rows from top to bottom
+		 * \param pitch - bytes from one row of rgba to the next (0 = w * 4, must be a multiple of 4)
+		 */
+		void CanvasBlit(Canvas& canvas, int x, int y, int w, int h, const unsigned char* rgba, int pitch = 0);
 
         /*==============================================================================
          * Window Functions
          *============================================================================*/
         void resizeWindow(int newWidth, int newHeight);
 
+		/**
+		 * Copies the last drawn frame (top row first, RGBA8, windowSize pixels).
+		 * Meant for EngineFlags::HEADLESS, for windows it reads the front buffer.
+		 *
+		 * \return - false if there is nothing to capture
+		 */
+		bool CaptureFrame(std::vector<unsigned char>& rgba);
+
 		/*==============================================================================
 		 * Keyboard functions
 		 *============================================================================*/
@@ -264,24 +502,66 @@ namespace RG3GE {
 
 		/** \brief what this does should be self explainatory
 		 * \param Shape2D - the shape to draw
-		 * \param Transform - the transformation will be taken into account
-		 * \param zLayer - value from -1 to 0.999999
-		 *                 will be drawn over all elements, that have a higher number then this
+		 * \param entry - the first entry in the transform buffer, that holds the transformation and zLayer
+		 *              (zLayer - value from -1 to 0.999999
+		 *               will be drawn over all elements, that have a higher number then this)
+		 * \param count - number of instances (using the entries that follow)
 		 */
-		void DrawShape2D(Shape2D, Transform& tr, float zLayer = 0);
+		void DrawShape2D(Shape2D, int entry, int count = 1);
+
+		/** Outputs the texture of the entry (and count - 1 following ones) to the screen, on the jobs zLayer under use of its transformation.  */
+		void	TextureDraw(int entry, int count = 1);
+
+		/** Merges consecutive render jobs, that share the same state, into batches and uploads their transforms. */
+		void _buildBatches();
+		void _writeTransform(uint32_t job);
+		void _createTransformBuffer();
+		void _createPrimitiveBuffer();
+		void _drawPrimitives(int entry, uint32_t layer);
+		void _uploadCanvases();
+		Texture _textureLoad(const char* filename, const std::string& cacheKey);
+		bool _textureCacheGet(const std::string& cacheKey, Texture& ret);
+		void _textureCacheTrim();
+		bool _streamTexture(TextureLoadJob& job, size_t& budget);
+		void _streamTextures();
+
+		/** Points the attributes of the bound vertex array at the Vertex2D data in the bound array buffer */
+		void _setupVertex2DAttributes(VertexFormat format);
 
-		/** Outputs the texture to the screen, on the given zLayer under use of the given transformation.  */
-		void	TextureDraw(Texture& t, Transform&, float zLayer = 0);
+		/** Issues the draw call for the (already bound) shape, emulating QUADS, QUAD_STRIP and POLYGON in the core profile */
+		void _drawShapeGeometry(const Shape2D& shape, int instanceCount = 1);
+		int _geometryAllocate(int verts, VertexFormat format, int& first, bool dedicated = false);
+		Shape2D _createShape2D(PolyShapes shape, int verts, const void* points, VertexFormat format);
+		bool _updateShape2D(Shape2D& shape, int first, const void* points, int verts, VertexFormat format, bool replace);
+		void _applyShapeUpdate(int id, int first, const void* points, int verts, bool replace);
 
+		/** true = QUADS, QUAD_STRIP and POLYGON are not available and have to be emulated */
+		bool coreProfile;
 
-        void freeTextureSlot(unsigned int slot, bool ignoreUsers = false);
+		/** true = everything is drawn into an offscreen framebuffer, that never gets shown */
+		bool headless;
+		bool _createOffscreenTarget(int width, int height);
+
+		/** Sorts, batches and draws everything in the frame queue, then swaps the window */
+		void _renderFrame();
+
+		/** Culls the jobs of the frame queue and fills _render_order with the visible ones in render order */
+		void _sortJobs();
+
+		/** \return - true = the frame was passed to the render thread (false = RenderAll has to draw it itself) */
+		bool _handOffFrame();
+		void _renderThreadMain();
+		void _startRenderThread();
+		void _stopRenderThread();
+
+
+        void freeTextureSlot(int handle, bool ignoreUsers = false);
+        bool _atlasInsert(TextureSlot* slot, unsigned char* pixels);
 
 		Engine();
 
 		static Engine* _instance;
 
-		Color currentTint;
-
 		SDL_GLContext context;
 		SDL_Window* window;
 
@@ -293,9 +573,8 @@ namespace RG3GE {
 		Vec2<float> origWindowSize;
 		Vec2<float> windowOffset;
 		Vec2<float> windowScale;
-		Uint32 ticks;
+		Uint64 ticks;
 
-		void _applyTransform(Transform& tr, float zLayer);
 		void _applyScreenSize();
 
 		Shape2D pixel;
@@ -20,3 +20,19 @@
 #define Debug(msg) /**/
 #endif
 #endif
+
+#ifndef ProfileZone
+#include "./Profiler.h"
+#ifdef RG3GE_PROFILER
+#define _RG3GE_PROFILE_CONCAT2(a, b) a##b
+#define _RG3GE_PROFILE_CONCAT(a, b) _RG3GE_PROFILE_CONCAT2(a, b)
+// Measures the time until the end of the current scope
+#define ProfileZone(name) RG3GE::Profiler::Zone _RG3GE_PROFILE_CONCAT(_profile_zone_, __LINE__)(name)
+#define ProfileThreadName(name) RG3GE::Profiler::SetThreadName(name)
+#define ProfileDump(filename) RG3GE::Profiler::DumpChromeTrace(filename)
+#else
+#define ProfileZone(name) /**/
+#define ProfileThreadName(name) /**/
+#define ProfileDump(filename) /**/
+#endif
+#endif
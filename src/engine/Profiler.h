@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../engine_config.h"
+
+// The profiler only exists in debug builds (or if ENGINE_PROFILE is defined)
+#if defined(DEBUG_BUILD) || defined(ENGINE_PROFILE)
+#define RG3GE_PROFILER 1
+
+#include <cstdint>
+
+namespace RG3GE::Profiler {
+
+	/**
+	 * Measures the time between its construction and destruction.
+	 * Use the ProfileZone macro from Macros.h instead of creating it directly.
+	 *
+	 * \param name - has to stay valid for the whole run of the application (use string literals)
+	 */
+	class Zone {
+	public:
+		Zone(const char* name);
+		~Zone();
+
+	private:
+		const char* name;
+		int64_t start;
+	};
+
+	/**
+	 * Gives the calling thread a name, that is shown in the trace instead of its number.
+	 * \param name - has to stay valid for the whole run of the application
+	 */
+	void SetThreadName(const char* name);
+
+	/**
+	 * Writes everything, that is still in the ring buffers of all threads, as
+	 * Chrome trace_event JSON (open via chrome://tracing or https://ui.perfetto.dev).
+	 *
+	 * \return - false if the file could not be written
+	 */
+	bool DumpChromeTrace(const char* filename);
+
+}
+
+#endif
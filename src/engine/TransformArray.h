@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace RG3GE {
+
+	struct Transform;
+
+	/**
+	 * Lots of Transforms stored as structure of arrays. They can be updated in bulk
+	 * (with SSE / AVX, if the compiler has them enabled) and submitted with a single
+	 * Engine::SubmitForRender call.
+	 *
+	 * Rotations are in degrees. The bulk functions only change `rotation`, call
+	 * updateDirections() once after all changes, to refresh `cos` / `sin` (that is what gets drawn).
+	 */
+	class TransformArray {
+	public:
+		std::vector<float> x, y;
+		std::vector<float> originX, originY;
+		std::vector<float> scaleX, scaleY;
+		std::vector<float> rotation;  // in degrees (the bulk functions keep it within -180 to 180)
+		std::vector<float> cos, sin;  // direction of the rotation
+
+		size_t size() const { return x.size(); }
+		void reserve(size_t n);
+		void clear();
+
+		/** \return - the index of the new entry */
+		size_t add(const Transform& tr);
+		void set(size_t i, const Transform& tr);
+		Transform get(size_t i) const;
+
+		void translate(float dx, float dy);
+		void rotate(float degrees);
+		void scale(float sx, float sy);
+
+		/** Adds dx[i] * factor / dy[i] * factor to every position (for example velocity * deltaTime) */
+		void translate(const float* dx, const float* dy, float factor = 1.0f);
+
+		/** Adds degrees[i] * factor to every rotation (for example rotation speed * deltaTime) */
+		void rotate(const float* degrees, float factor = 1.0f);
+
+		/** Recomputes cos / sin from rotation (float approximation, the error is below 1e-6) */
+		void updateDirections();
+	};
+
+}
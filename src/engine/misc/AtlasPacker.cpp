@@ -0,0 +1,81 @@
+#include "./AtlasPacker.h"
+
+namespace RG3GE::Core {
+
+    AtlasPacker::AtlasPacker(int width, int height) { reset(width, height); }
+
+    void AtlasPacker::reset(int w, int h) {
+        width = w;
+        height = h;
+        skyline.clear();
+        skyline.push_back({0, 0, w});
+    }
+
+    int AtlasPacker::fit(size_t node, int w, int h) {
+        int x = skyline[node].x;
+        if (x + w > width) return -1;
+
+        int y = 0;
+        int remaining = w;
+        for (size_t i = node; remaining > 0; i++) {
+            if (i >= skyline.size()) return -1;
+            if (skyline[i].y > y) y = skyline[i].y;
+            if (y + h > height) return -1;
+            remaining -= skyline[i].width;
+        }
+
+        return y;
+    }
+
+    bool AtlasPacker::insert(int w, int h, int& x, int& y) {
+        if (w <= 0 || h <= 0) return false;
+
+        int bestNode = -1;
+        int bestBottom = height + 1;
+        int bestWidth = width + 1;
+
+        for (size_t i = 0; i < skyline.size(); i++) {
+            int ny = fit(i, w, h);
+            if (ny < 0) continue;
+
+            if (ny + h < bestBottom || (ny + h == bestBottom && skyline[i].width < bestWidth)) {
+                bestNode = (int)i;
+                bestBottom = ny + h;
+                bestWidth = skyline[i].width;
+                x = skyline[i].x;
+                y = ny;
+            }
+        }
+
+        if (bestNode == -1) return false;
+
+        // Raise the skyline where the rectangle was placed
+        skyline.insert(skyline.begin() + bestNode, {x, y + h, w});
+
+        for (size_t i = bestNode + 1; i < skyline.size();) {
+            SkylineNode& prev = skyline[i - 1];
+            SkylineNode& n = skyline[i];
+            int overlap = prev.x + prev.width - n.x;
+            if (overlap <= 0) break;
+
+            n.x += overlap;
+            n.width -= overlap;
+            if (n.width > 0) break;
+
+            skyline.erase(skyline.begin() + i);
+        }
+
+        // Merge neighbours on the same height
+        for (size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * Skyline (bottom-left) rectangle packer, used to place images inside a texture atlas page.
+     * Rectangles can only be added. Freeing happens by resetting the whole page.
+     */
+    class AtlasPacker {
+    public:
+        AtlasPacker(int width = 0, int height = 0);
+
+        /** Forgets all packed rectangles */
+        void reset(int width, int height);
+
+        /**
+         * Finds a free spot for a rectangle of the given size.
+         *
+         * \param x, y - receive the top left corner of the spot
+         * \return - false if the page has no room left for the rectangle
+         */
+        bool insert(int w, int h, int& x, int& y);
+
+    private:
+        struct SkylineNode {
+            int x, y, width;
+        };
+
+        int width, height;
+        std::vector<SkylineNode> skyline;
+
+        /** \return - the y position a rectangle would get, if placed at the given node (or -1 if it does not fit) */
+        int fit(size_t node, int w, int h);
+    };
+
+}
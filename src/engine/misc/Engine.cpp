@@ -6,14 +6,37 @@
 #include "../Macros.h"
 
 #include "../Transform.h"
+#include "../TransformArray.h"
 #include <iostream>
 #include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <filesystem>
 
 #include "../vendor/stb_image.h"
 #include "./Shader.h"
+#include "./RadixSort.h"
+#include "./AtlasPacker.h"
+#include "./GeometryHeap.h"
+#include "./PixelCanvas.h"
+#include "./WorkerPool.h"
+#include "./HandlePool.h"
+#include "./RenderQueue.h"
+#include "./gl_helper.h"
 
 namespace RG3GE {
 
+static RG3GE::Core::GLState _gl;
+
+// Render target of EngineFlags::HEADLESS (color, depth)
+static unsigned int _offscreen_fbo = 0;
+static unsigned int _offscreen_buffers[2] = {0, 0};
+
 //=============================================================================
 // TextureSlots
 //-----------------------------------------------------------------------------
@@ -24,25 +47,279 @@ struct TextureSlot {
     unsigned int _gl_texture_id = -1;
     Shape2D texture_plane;
     unsigned int users = 0;
+
+    // Where the image is stored inside _gl_texture_id (only differs from width/height for atlas pages)
+    int texX = 0, texY = 0;
+    int texWidth = 0, texHeight = 0;
+    int atlasPage = -1;
+
+    bool opaque = false;  // true = every pixel has an alpha of 255
+
+    // Not READY = _gl_texture_id is the shared placeholder (see TextureLoadAsync)
+    TextureLoadState state = TextureLoadState::READY;
+
+    std::string cacheKey;  // empty = not in _texture_cache
+    uint64_t cacheUsed = 0;  // last load, that returned this slot (_texture_cache_clock)
 };
-static TextureSlot _texture_slots[ENGINE_TEXTURE_LIMIT];
-void Engine::freeTextureSlot(unsigned int slot, bool ignoreUsers) {
-    if (_texture_slots[slot].users > 0) _texture_slots[slot].users--;
+static RG3GE::Core::HandlePool<TextureSlot> _texture_slots;
+
+//-----------------------------------------------------------------------------
+// Texture cache
+//   Normalized path -> TextureSlot handle. The cache holds one of the users
+//   of the slot, so a texture stays in VRAM after its last handle is destroyed.
+//   Those unused textures are evicted (least recently loaded first), once they
+//   take more than ENGINE_TEXTURE_CACHE_BYTES.
+//-----------------------------------------------------------------------------
+static std::unordered_map<std::string, int> _texture_cache;
+static std::mutex _texture_cache_mutex;
+static uint64_t _texture_cache_clock = 0;
+static unsigned int _texture_cache_hits = 0;
+static unsigned int _texture_cache_misses = 0;
+
+/** "./a/../ship.png" and "ship.png" are the same file */
+static std::string _textureCacheKey(const char* filename) {
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::absolute(filename, error);
+    if (!error) path = std::filesystem::weakly_canonical(path, error);
+    if (error) path = std::filesystem::path(filename).lexically_normal();
+    return path.string();
+}
+
+/**
+ * Removes the slot from the cache (if the path still belongs to it). The user, that the cache was, is kept.
+ * \return - true = the slot was in the cache
+ */
+static bool _textureCacheRemove(int handle, TextureSlot* slot) {
+    if (slot->cacheKey.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+    auto it = _texture_cache.find(slot->cacheKey);
+    slot->cacheKey.clear();
+    if (it == _texture_cache.end() || it->second != handle) return false;
+
+    _texture_cache.erase(it);
+    return true;
+}
+
+/** Makes the cache one of the users of the slot (GL thread only) */
+static void _textureCachePut(const std::string& key, int handle, TextureSlot* slot) {
+    std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+    if (!_texture_cache.emplace(key, handle).second) return;
+
+    slot->cacheKey = key;
+    slot->cacheUsed = ++_texture_cache_clock;
+    slot->users++;
+}
+
+static size_t _textureBytes(const TextureSlot* slot) {
+    return (size_t)slot->width * slot->height * 4;
+}
 
-    if (ignoreUsers || _texture_slots[slot].users == 0) {
-        GLCALL(glDeleteTextures(1, &(_texture_slots[slot]._gl_texture_id)));
-        _texture_slots[slot].width = 0;
-        _texture_slots[slot].height = 0;
-        _texture_slots[slot].colorchannels = 0;
-        DestroyShape2D(_texture_slots[slot].texture_plane);
+//-----------------------------------------------------------------------------
+// Async texture loading
+//   Workers decode the files, RenderAll copies the pixels into a texture of
+//   their own (a few rows per frame) and only then swaps it into the slot.
+//   The list is only used by the GL thread, workers only fill in their job.
+//-----------------------------------------------------------------------------
+struct TextureLoadJob {
+    int slot;  // TextureSlot handle
+    std::string filename;
+    int width, height;
+
+    // Set by the worker (guarded by _texture_loads_mutex)
+    bool decoded = false;
+    unsigned char* pixels = nullptr;  // nullptr = could not be decoded
+    bool opaque = false;
+
+    unsigned int texture = 0;  // receives the rows, until all of them are there
+    int rowsDone = 0;
+};
+static std::vector<std::shared_ptr<TextureLoadJob>> _texture_loads;
+static std::mutex _texture_loads_mutex;
+static std::condition_variable _texture_loads_cv;
+static RG3GE::Core::WorkerPool _texture_load_workers;
+
+static unsigned int _placeholder_texture = 0;
+static unsigned int _texture_upload_buffer = 0;  // GL_PIXEL_UNPACK_BUFFER
+
+/** Drops everything, that is still loading (the slots keep showing the placeholder) */
+static void _stopTextureLoads() {
+    _texture_load_workers.stop();
+
+    for (auto& job : _texture_loads) {
+        stbi_image_free(job->pixels);
+        if (job->texture) {
+            _gl.forgetTexture(job->texture);
+            GLCALL(glDeleteTextures(1, &job->texture));
+        }
     }
+    _texture_loads.clear();
+}
+
+//=============================================================================
+// ShapeSlots
+//-----------------------------------------------------------------------------
+//=============================================================================
+struct ShapeSlot {
+    Shape2D shape;
+    int block = -1;        // GeometryBlock, that holds the vertices (-1 = shape has no vertices)
+    bool dynamic = false;  // true = was updated via UpdateShape2D and has a block of its own
+
+    // Bounding box of the vertices (used for culling)
+    float minX = 0.0f, minY = 0.0f;
+    float maxX = 0.0f, maxY = 0.0f;
+
+    bool opaque = false;  // true = all vertex colors have an alpha of 1
+};
+static RG3GE::Core::HandlePool<ShapeSlot> _shape_slots;
+
+//-----------------------------------------------------------------------------
+// Geometry heap
+//   The vertices of all Shape2Ds are placed inside a few large vertex buffers.
+//   Each buffer has a single vertex array, so shapes of the same block are
+//   drawn one after another without rebinding anything.
+//-----------------------------------------------------------------------------
+struct GeometryBlock {
+    unsigned int buffer = 0;  // 0 = block is not in use
+    unsigned int vertexArray = 0;
+    RG3GE::Core::GeometryHeap heap;
+    VertexFormat format = VertexFormat::FLOAT;  // all shapes in a block share the attribute setup
+    bool dedicated = false;  // true = holds a single shape, that is too large or gets updated
+};
+static std::vector<GeometryBlock> _geometry_blocks;
+
+static_assert(sizeof(PackedVertex2D) == 16, "PackedVertex2D has to stay tightly packed");
+
+static size_t _vertexSize(VertexFormat format) {
+    return format == VertexFormat::PACKED ? sizeof(PackedVertex2D) : sizeof(Vertex2D);
 }
-static int nextFreeTextureSlot() {
-    for (int a = 0; a < ENGINE_TEXTURE_LIMIT; a++) {
-        if (_texture_slots[a].colorchannels == 0)
-            return a;
+
+static void _geometryFree(int block, int first, int count) {
+    if (block < 0) return;
+
+    GeometryBlock& g = _geometry_blocks[block];
+    g.heap.free(first, count);
+
+    // Blocks that were made for a single shape are not worth keeping
+    if (g.heap.used() == 0 && g.dedicated) {
+        _gl.forgetVertexArray(g.vertexArray);
+        _gl.forgetBuffer(g.buffer);
+        GLCALL(glDeleteVertexArrays(1, &g.vertexArray));
+        GLCALL(glDeleteBuffers(1, &g.buffer));
+        g.vertexArray = 0;
+        g.buffer = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Texture Atlas
+//-----------------------------------------------------------------------------
+struct AtlasPage {
+    unsigned int _gl_texture_id = 0;
+    Shape2D texture_plane;
+    RG3GE::Core::AtlasPacker packer;
+    unsigned int users = 0;
+};
+static std::vector<AtlasPage> _atlas_pages;
+
+void Engine::freeTextureSlot(int handle, bool ignoreUsers) {
+    TextureSlot* slot = _texture_slots.get(handle);
+    if (!slot) {
+        Debug("Warning!!! : texture handle is stale (texture was already destroyed)");
+        return;
+    }
+
+    if (slot->users > 0) slot->users--;
+
+    // Only the cache is left
+    if (!ignoreUsers && slot->users == 1 && !slot->cacheKey.empty()) {
+        _textureCacheTrim();
+        return;
+    }
+
+    if (ignoreUsers || slot->users == 0) {
+        if (slot->atlasPage >= 0) {
+            // The space on the page is only reclaimed, once all images on it are gone
+            AtlasPage& page = _atlas_pages[slot->atlasPage];
+            if (--page.users == 0) {
+                _gl.forgetTexture(page._gl_texture_id);
+                GLCALL(glDeleteTextures(1, &page._gl_texture_id));
+                DestroyShape2D(page.texture_plane);
+                page._gl_texture_id = 0;
+            }
+        } else {
+            if (slot->state == TextureLoadState::READY) {
+                _gl.forgetTexture(slot->_gl_texture_id);
+                GLCALL(glDeleteTextures(1, &slot->_gl_texture_id));
+            }
+            DestroyShape2D(slot->texture_plane);
+        }
+
+        _textureCacheRemove(handle, slot);
+        _texture_slots.release(handle);
     }
-    return -1;
+}
+
+/**
+ * Copies the image into the first atlas page, that has room for it (creates a new page if needed).
+ * \return - false if the image has to get its own texture
+ */
+bool Engine::_atlasInsert(TextureSlot* slot, unsigned char* pixels) {
+    if (ENGINE_ATLAS_PAGE_SIZE <= 0 ||
+        slot->width > ENGINE_ATLAS_MAX_IMAGE_SIZE || slot->height > ENGINE_ATLAS_MAX_IMAGE_SIZE)
+        return false;
+
+    // 1px gap between images, so nearest neighbour sampling never picks up a neighbour
+    int x, y, page = -1;
+    for (size_t p = 0; p < _atlas_pages.size() && page == -1; p++) {
+        if (_atlas_pages[p]._gl_texture_id && _atlas_pages[p].packer.insert(slot->width + 1, slot->height + 1, x, y))
+            page = (int)p;
+    }
+
+    if (page == -1) {
+        for (size_t p = 0; p < _atlas_pages.size() && page == -1; p++)
+            if (!_atlas_pages[p]._gl_texture_id) page = (int)p;
+
+        if (page == -1) {
+            page = (int)_atlas_pages.size();
+            _atlas_pages.emplace_back();
+        }
+
+        AtlasPage& ap = _atlas_pages[page];
+        ap.packer.reset(ENGINE_ATLAS_PAGE_SIZE, ENGINE_ATLAS_PAGE_SIZE);
+        ap.users = 0;
+        if (!ap.packer.insert(slot->width + 1, slot->height + 1, x, y)) return false;
+
+        std::vector<unsigned char> clear(ENGINE_ATLAS_PAGE_SIZE * ENGINE_ATLAS_PAGE_SIZE * 4, 0);
+        GLCALL(glGenTextures(1, &ap._gl_texture_id));
+        GLCALL(_gl.bindTexture(ap._gl_texture_id));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ENGINE_ATLAS_PAGE_SIZE, ENGINE_ATLAS_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, clear.data()));
+
+        float size = (float)ENGINE_ATLAS_PAGE_SIZE;
+        ap.texture_plane = CreateShape2D(RG3GE::PolyShapes::QUADS, {{0.0f, 0.0f, 0.0f, 0.0f},
+                                                                    {size, 0.0f, 1.0f, 0.0f},
+                                                                    {size, size, 1.0f, 1.0f},
+                                                                    {0.0f, size, 0.0f, 1.0f}});
+    }
+
+    AtlasPage& ap = _atlas_pages[page];
+    GLCALL(_gl.bindTexture(ap._gl_texture_id));
+    GLCALL(glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, slot->width, slot->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+    ap.users++;
+
+    slot->_gl_texture_id = ap._gl_texture_id;
+    slot->texture_plane = ap.texture_plane;
+    slot->atlasPage = page;
+    slot->texX = x;
+    slot->texY = y;
+    slot->texWidth = ENGINE_ATLAS_PAGE_SIZE;
+    slot->texHeight = ENGINE_ATLAS_PAGE_SIZE;
+
+    return true;
 }
 #pragma endregion
 
@@ -51,60 +328,755 @@ static int nextFreeTextureSlot() {
 //-----------------------------------------------------------------------------
 //=============================================================================
 #pragma region Renderer
-union RenderSubject {
-    Shape2D shape;
-    Texture texture;
+using RG3GE::Core::RenderQueue;
+
+// false = everything goes through the blended back to front pass
+static std::atomic<bool> _opaque_pass = true;
+
+/**
+ * Packs everything the render order depends on into 64 bits:
+ * [63]     blended  - opaque jobs (0) are drawn before the blended ones (1)
+ * [62..40] depth    - quantized zDepth, opaque: lower zDepth first (front to back)
+ *                                       blended: higher zDepth first (back to front)
+ * [39..38] type     - Shape2D / Texture / Primitives
+ * [37..16] subject  - OpenGL texture (atlas page), geometry block + shape or primitive layer
+ * [15..0]  tint     - folded RGBA8 of the tint
+ * Jobs on the same layer are grouped by state, so they can be batched afterwards.
+ */
+static uint64_t _renderKey(float zDepth, unsigned char type, unsigned int subject, uint32_t rgba, bool opaque) {
+    float z = std::min(std::max(zDepth, -1.0f), 1.0f);
+
+    // Opaque jobs let the depth test reject what is hidden behind them, so they go front to back
+    opaque = opaque && (rgba >> 24) == 0xFF && _opaque_pass;
+    uint64_t depth = (uint64_t)((opaque ? (1.0f + z) : (1.0f - z)) * 0.5f * 0x7FFFFF);
+
+    return (uint64_t)!opaque << 63 |
+           depth << 40 |
+           (uint64_t)(type & 0x3) << 38 |
+           (uint64_t)(subject & 0x3FFFFF) << 16 |
+           ((rgba ^ (rgba >> 16)) & 0xFFFF);
+}
 
-    RenderSubject(){};
+//-----------------------------------------------------------------------------
+// Submission buffers
+//   Every thread, that submits jobs, records into its own RenderQueue (and has its own tint).
+//   The mutex is only taken when a thread submits for the first time and by RenderAll.
+//-----------------------------------------------------------------------------
+struct SubmitBuffer {
+    RenderQueue queue;
+    Color tint = {1.0f, 1.0f, 1.0f, 1.0f};
+    bool owned = true;  // false = the thread has ended, the buffer can be handed to a new one
 };
-struct RenderJob {
-    Transform tr;
-    unsigned char type;
-    float zDepth;
-    RenderSubject subject;
-    Color tint;
+static std::vector<std::unique_ptr<SubmitBuffer>> _submit_buffers;
+static std::mutex _submit_buffers_mutex;
+
+/** Gives the buffer back, once the thread that used it ends (jobs that are still in it get rendered) */
+struct SubmitBufferOwner {
+    SubmitBuffer* buffer = nullptr;
+    ~SubmitBufferOwner() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(_submit_buffers_mutex);
+        buffer->owned = false;
+    }
+};
+static thread_local SubmitBufferOwner _submit_buffer_owner;
+
+static SubmitBuffer& _submitBuffer() {
+    SubmitBuffer* b = _submit_buffer_owner.buffer;
+    if (b) return *b;
+
+    std::lock_guard<std::mutex> lock(_submit_buffers_mutex);
+    for (auto& it : _submit_buffers)
+        if (!it->owned && it->queue.size() == 0) {
+            b = it.get();
+            break;
+        }
 
-    RenderJob() : tr(), type(0), zDepth(0), subject(), tint(0.0f, 0.0f, 0.0f, 0.0f) {}
-    RenderJob(Transform tr, unsigned char type, float zDepth, Shape2D shape, Color c)
-        : tr(tr), type(type), zDepth(zDepth), tint(c) {
-        subject.shape = shape;
+    if (!b) {
+        _submit_buffers.push_back(std::make_unique<SubmitBuffer>());
+        b = _submit_buffers.back().get();
+        b->queue.reserve(ENGINE_DRAW_CALL_LIMIT);
     }
 
-    RenderJob(Transform tr, unsigned char type, float zDepth, Texture texture, Color c)
-        : tr(tr), type(type), zDepth(zDepth), tint(c) {
-        subject.texture = texture;
+    b->owned = true;
+    b->tint = {1.0f, 1.0f, 1.0f, 1.0f};
+    _submit_buffer_owner.buffer = b;
+    return *b;
+}
+
+static void _submitShape(Shape2D& shape, Transform& tr, float zDepth, uint32_t tint) {
+    ShapeSlot* slot = _shape_slots.get(shape.id);
+    if (!slot) {
+        Debug("Warning!!! : shape was not created via CreateShape2D or is already destroyed");
+        return;
     }
-};
-static std::vector<RenderJob> _render_jobs;
+
+    _submitBuffer().queue.push(RenderQueue::SHAPE, (uint32_t)shape.id, tr, zDepth, tint,
+                               _renderKey(zDepth, RenderQueue::SHAPE, (uint32_t)slot->block << 16 | ((uint32_t)shape.id & 0xFFFF), tint, slot->opaque));
+}
+
+/**
+ * Textures, that are still loading, all share the placeholder, but each of them has a plane of its own size.
+ * So they are grouped by slot instead of by OpenGL texture.
+ */
+static unsigned int _textureSubject(int handle, TextureSlot* slot) {
+    return slot->state == TextureLoadState::READY ? slot->_gl_texture_id : (unsigned int)handle;
+}
+
+// All jobs of the current frame (merged from the submission buffers by RenderAll)
+static RenderQueue _render_queue;
+static std::vector<uint32_t> _render_order;
+static std::vector<uint32_t> _render_order_scratch;
 void Engine::SubmitForRender(Shape2D& shape, Transform& tr, float zDepth) {
-    _render_jobs.push_back({tr, 0, zDepth, shape, currentTint});
+    _submitShape(shape, tr, zDepth, RG3GE::Core::PackRGBA8(_submitBuffer().tint));
 }
 void Engine::SubmitForRender(Texture& texture, Transform& tr, float zDepth) {
-    _render_jobs.push_back({tr, 1, zDepth, texture, currentTint});
+    TextureSlot* slot = _texture_slots.get(texture.slot);
+    if (!slot) {
+        Debug("Warning!!! : texture has no slot assigned");
+        return;
+    }
+
+    SubmitBuffer& b = _submitBuffer();
+    uint32_t tint = RG3GE::Core::PackRGBA8(b.tint);
+    b.queue.pushTexture(texture, tr, zDepth, tint,
+                        _renderKey(zDepth, RenderQueue::TEXTURE, _textureSubject(texture.slot, slot), tint, slot->opaque));
+}
+void Engine::SubmitForRender(Shape2D& shape, TransformArray& trs, float zDepth) {
+    ShapeSlot* slot = _shape_slots.get(shape.id);
+    if (!slot) {
+        Debug("Warning!!! : shape was not created via CreateShape2D or is already destroyed");
+        return;
+    }
+
+    SubmitBuffer& b = _submitBuffer();
+    uint32_t tint = RG3GE::Core::PackRGBA8(b.tint);
+    b.queue.push(RenderQueue::SHAPE, (uint32_t)shape.id, trs, zDepth, tint,
+                 _renderKey(zDepth, RenderQueue::SHAPE, (uint32_t)slot->block << 16 | ((uint32_t)shape.id & 0xFFFF), tint, slot->opaque));
+}
+void Engine::SubmitForRender(Texture& texture, TransformArray& trs, float zDepth) {
+    TextureSlot* slot = _texture_slots.get(texture.slot);
+    if (!slot) {
+        Debug("Warning!!! : texture has no slot assigned");
+        return;
+    }
+    if (trs.size() == 0) return;
+
+    SubmitBuffer& b = _submitBuffer();
+    uint32_t tint = RG3GE::Core::PackRGBA8(b.tint);
+    b.queue.pushTexture(texture, trs, zDepth, tint,
+                        _renderKey(zDepth, RenderQueue::TEXTURE, _textureSubject(texture.slot, slot), tint, slot->opaque));
+}
+
+//-----------------------------------------------------------------------------
+// Batching
+//-----------------------------------------------------------------------------
+/**
+ * Everything the universal.vert needs to know about a job (one entry per drawn job and frame,
+ * in the order they are drawn, so batches can use consecutive entries as instances)
+ */
+struct JobTransform {
+    float tx, ty, ax, ay;             // translation (in screen space), angle as cos/sin
+    float ox, oy, sx, sy;             // origin, scale (in screen space)
+    float cropW, cropH, u, v;         // texture crop
+    float r, g, b, a;                 // tint
+    float z, unused[3];
+};
+static_assert(sizeof(JobTransform) == 5 * 4 * sizeof(float), "universal.vert reads 5 RGBA32F texels per job");
+
+struct RenderBatch {
+    unsigned char type;
+    int firstJob;  // in _render_order (= first entry in the transform buffer)
+    int jobCount;
+};
+static std::vector<RenderBatch> _render_batches;
+static std::vector<JobTransform> _job_transforms;
+static unsigned int _transform_buffer = 0;
+static unsigned int _transform_texture = 0;
+static std::atomic<unsigned int> _batch_count = 0;
+static std::atomic<unsigned int> _culled_count = 0;
+
+//-----------------------------------------------------------------------------
+// Primitive stream
+//   DrawPixel, DrawLine and DrawRectFilled write triangles into the primitive layers
+//   of the RenderQueue. Each frame all layers are streamed into one buffer and every
+//   layer becomes a single job (so it is still ordered by its zLayer).
+//-----------------------------------------------------------------------------
+struct PrimitiveRange {
+    int first, count;  // in vertices
+};
+static std::vector<PrimitiveRange> _primitive_ranges;  // one per layer of the current frame
+static unsigned int _primitive_buffer = 0;
+static unsigned int _primitive_vertex_array = 0;
+static int _primitive_capacity = 0;
+
+//-----------------------------------------------------------------------------
+// Frame statistics
+//-----------------------------------------------------------------------------
+static FrameStats _frame_stats;     // the last finished frame
+static FrameStats _frame_counting;  // the frame, that is drawn right now
+static std::mutex _frame_stats_mutex;
+
+// GL_TIME_ELAPSED queries, used in turns, so the result is read two frames after it was measured
+static unsigned int _gpu_timers[2] = {0, 0};
+static bool _gpu_timer_used[2] = {false, false};
+static int _gpu_timer_current = 0;
+
+static bool _isOpaque(RenderQueue& q, uint32_t job) { return !(q.key[job] >> 63); }
+
+static bool _canBatch(RenderQueue& q, uint32_t a, uint32_t b) {
+    if (q.type[a] != q.type[b] || _isOpaque(q, a) != _isOpaque(q, b)) return false;
+
+    switch (q.type[a]) {
+        case RenderQueue::SHAPE:  // Instances take their tint from the transform buffer
+            return q.subject[a] == q.subject[b];
+
+        case RenderQueue::TEXTURE: {  // Textures on the same atlas page share their OpenGL texture and plane
+            TextureSlot* sa = _texture_slots.get(q.textures[q.subject[a]].slot);
+            TextureSlot* sb = _texture_slots.get(q.textures[q.subject[b]].slot);
+            return sa && sb && sa->_gl_texture_id == sb->_gl_texture_id && sa->texture_plane.id == sb->texture_plane.id;
+        }
+
+        case RenderQueue::PRIMITIVES:  // Every layer is a draw call of its own already
+            return false;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Index patterns
+//   Shared static index buffers, that turn QUADS, QUAD_STRIP and POLYGON into triangle lists
+//   (used by the core profile, where those primitives do not exist)
+//-----------------------------------------------------------------------------
+enum IndexPattern { PATTERN_QUADS = 0, PATTERN_QUAD_STRIP, PATTERN_POLYGON, PATTERN_CNT };
+struct IndexPatternBuffer {
+    unsigned int buffer = 0;
+    int vertexCapacity = 0;
+};
+static IndexPatternBuffer _index_patterns[PATTERN_CNT];
+
+static int _indexPatternOf(PolyShapes shape) {
+    switch (shape) {
+        case PolyShapes::QUADS: return PATTERN_QUADS;
+        case PolyShapes::QUAD_STRIP: return PATTERN_QUAD_STRIP;
+        case PolyShapes::POLYGON: return PATTERN_POLYGON;
+        default: return -1;
+    }
+}
+
+/** \return - how many indices are needed to draw the given number of vertices as triangles */
+static int _indexPatternCount(int pattern, int vertexCnt) {
+    switch (pattern) {
+        case PATTERN_QUADS: return (vertexCnt / 4) * 6;
+        case PATTERN_QUAD_STRIP: return vertexCnt < 4 ? 0 : ((vertexCnt - 2) / 2) * 6;
+        case PATTERN_POLYGON: return vertexCnt < 3 ? 0 : (vertexCnt - 2) * 3;
+    }
+    return 0;
+}
+
+/**
+ * Makes sure the pattern covers at least vertexCnt vertices.
+ * The buffer keeps its name when it grows, so vertex arrays that already use it stay valid.
+ *
+ * \return - the GL buffer, that has to be bound as GL_ELEMENT_ARRAY_BUFFER of the vertex array
+ */
+static unsigned int _reserveIndexPattern(int pattern, int vertexCnt) {
+    IndexPatternBuffer& p = _index_patterns[pattern];
+    if (p.buffer && vertexCnt <= p.vertexCapacity) return p.buffer;
+
+    // Grow in steps, so shapes with slightly more vertices do not rebuild the buffer every time
+    int capacity = std::max(vertexCnt, std::max(p.vertexCapacity * 2, 1024));
+    capacity += capacity % 2;
+
+    std::vector<unsigned int> indices;
+    indices.reserve(_indexPatternCount(pattern, capacity));
+    switch (pattern) {
+        case PATTERN_QUADS:
+            for (unsigned int v = 0; v + 3 < (unsigned int)capacity; v += 4)
+                indices.insert(indices.end(), {v + 0, v + 1, v + 2, v + 0, v + 2, v + 3});
+            break;
+
+        case PATTERN_QUAD_STRIP:
+            for (unsigned int v = 0; v + 3 < (unsigned int)capacity; v += 2)
+                indices.insert(indices.end(), {v + 0, v + 1, v + 3, v + 0, v + 3, v + 2});
+            break;
+
+        case PATTERN_POLYGON:
+            for (unsigned int v = 1; v + 1 < (unsigned int)capacity; v++)
+                indices.insert(indices.end(), {0, v, v + 1});
+            break;
+    }
+
+    if (!p.buffer) GLCALL(glGenBuffers(1, &p.buffer));
+
+    // Upload through the copy target, so the element binding of the current vertex array is left alone
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, p.buffer));
+    GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    p.vertexCapacity = capacity;
+
+    return p.buffer;
+}
+
+void Engine::_writeTransform(uint32_t job) {
+    RenderQueue& q = _render_queue;
+
+    JobTransform t = {};
+    t.tx = q.x[job] * 2.0f * windowScale.x + windowOffset.x;
+    t.ty = q.y[job] * 2.0f * windowScale.y + windowOffset.y;
+    t.ax = q.cos[job];
+    t.ay = q.sin[job];
+    t.ox = q.originX[job];
+    t.oy = q.originY[job];
+    t.sx = q.scaleX[job] * 2.0f * windowScale.x;
+    t.sy = q.scaleY[job] * 2.0f * windowScale.y;
+
+    if (q.type[job] == RenderQueue::TEXTURE) {
+        RenderQueue::TextureRef& tex = q.textures[q.subject[job]];
+        t.cropW = tex.cropW;
+        t.cropH = tex.cropH;
+        t.u = tex.u;
+        t.v = tex.v;
+    }
+
+    Color c = RG3GE::Core::UnpackRGBA8(q.tint[job]);
+    t.r = c.r;
+    t.g = c.g;
+    t.b = c.b;
+    t.a = c.a;
+    t.z = q.z[job];
+
+    _job_transforms.push_back(t);
+}
+
+void Engine::_buildBatches() {
+    _render_batches.clear();
+    _job_transforms.clear();
+
+    RenderQueue& q = _render_queue;
+
+    size_t cnt = _render_order.size();
+    for (size_t i = 0; i < cnt;) {
+        uint32_t first = _render_order[i];
+
+        size_t end = i + 1;
+        while (end < cnt && _canBatch(q, first, _render_order[end])) end++;
+
+        _render_batches.push_back({q.type[first], (int)i, (int)(end - i)});
+        i = end;
+    }
+
+    for (size_t i = 0; i < cnt; i++)
+        _writeTransform(_render_order[i]);
+
+    // All transforms of this frame in a single upload (also orphans last frames buffer)
+    if (cnt > 0) {
+        GLCALL(glBindBuffer(GL_TEXTURE_BUFFER, _transform_buffer));
+        GLCALL(glBufferData(GL_TEXTURE_BUFFER, _job_transforms.size() * sizeof(JobTransform), _job_transforms.data(), GL_STREAM_DRAW));
+    }
+
+    _batch_count = (unsigned int)_render_batches.size();
+}
+
+//-----------------------------------------------------------------------------
+// Culling
+//-----------------------------------------------------------------------------
+/**
+ * Fills `visible` with all jobs, whose bounding box touches the view rectangle (in game coordinates).
+ * The box is a conservative one: the local bounds are rotated as a box, not per vertex.
+ */
+static void _cullJobs(RenderQueue& q, float viewMinX, float viewMinY, float viewMaxX, float viewMaxY, std::vector<uint32_t>& visible) {
+    visible.clear();
+
+    size_t cnt = q.size();
+    for (size_t job = 0; job < cnt; job++) {
+        float minX, minY, maxX, maxY;
+
+        if (q.type[job] == RenderQueue::PRIMITIVES) {  // a layer covers anything, that was drawn on it
+            visible.push_back((uint32_t)job);
+            continue;
+        } else if (q.type[job] == RenderQueue::SHAPE) {
+            ShapeSlot* shape = _shape_slots.get(q.subject[job]);
+            if (!shape) continue;
+            minX = shape->minX;
+            minY = shape->minY;
+            maxX = shape->maxX;
+            maxY = shape->maxY;
+        } else {
+            RenderQueue::TextureRef& t = q.textures[q.subject[job]];
+            TextureSlot* slot = _texture_slots.get(t.slot);
+            if (!slot) continue;
+            minX = 0.0f;
+            minY = 0.0f;
+            maxX = slot->texWidth * t.cropW;
+            maxY = slot->texHeight * t.cropH;
+        }
+
+        // Local box relative to the origin and scaled (the scale may flip it)
+        float x0 = (minX - q.originX[job]) * q.scaleX[job];
+        float x1 = (maxX - q.originX[job]) * q.scaleX[job];
+        float y0 = (minY - q.originY[job]) * q.scaleY[job];
+        float y1 = (maxY - q.originY[job]) * q.scaleY[job];
+
+        float cx = (x0 + x1) * 0.5f, cy = (y0 + y1) * 0.5f;
+        float hx = std::abs(x1 - x0) * 0.5f, hy = std::abs(y1 - y0) * 0.5f;
+
+        // Rotate the center and grow the extents to cover the rotated box
+        float cs = q.cos[job], sn = q.sin[job];
+        float acs = std::abs(cs), asn = std::abs(sn);
+        float wx = q.x[job] + cx * cs - cy * sn;
+        float wy = q.y[job] + cx * sn + cy * cs;
+        float ex = acs * hx + asn * hy;
+        float ey = asn * hx + acs * hy;
+
+        if (wx + ex < viewMinX || wx - ex > viewMaxX || wy + ey < viewMinY || wy - ey > viewMaxY) continue;
+
+        visible.push_back((uint32_t)job);
+    }
+
+    _culled_count = (unsigned int)(cnt - visible.size());
+}
+
+/** Uploads the primitive layers of the frame and adds a job for each of them */
+static void _streamPrimitives(RenderQueue& q) {
+    _primitive_ranges.clear();
+    if (q.primitiveLayers == 0) return;
+
+    int total = 0;
+    for (size_t i = 0; i < q.primitiveLayers; i++) {
+        int cnt = (int)q.primitives[i].vertices.size();
+        _primitive_ranges.push_back({total, cnt});
+        total += cnt;
+    }
+
+    // New storage every frame (orphaning), so the last frame can still be drawn from the old one
+    _primitive_capacity = std::max(_primitive_capacity, total);
+    GLCALL(_gl.bindArrayBuffer(_primitive_buffer));
+    GLCALL(glBufferData(GL_ARRAY_BUFFER, _primitive_capacity * sizeof(PackedVertex2D), nullptr, GL_STREAM_DRAW));
+    for (size_t i = 0; i < q.primitiveLayers; i++) {
+        PrimitiveRange& r = _primitive_ranges[i];
+        if (r.count > 0)
+            GLCALL(glBufferSubData(GL_ARRAY_BUFFER, r.first * sizeof(PackedVertex2D), r.count * sizeof(PackedVertex2D), q.primitives[i].vertices.data()));
+    }
+
+    // The vertices are in game coordinates already
+    Transform identity = {{0.0f}, {0.0f}, {1.0f}, 0.0f};
+    for (size_t i = 0; i < q.primitiveLayers; i++) {
+        RenderQueue::PrimitiveLayer& l = q.primitives[i];
+        q.push(RenderQueue::PRIMITIVES, (uint32_t)i, identity, l.z, 0xFFFFFFFF,
+               _renderKey(l.z, RenderQueue::PRIMITIVES, (uint32_t)i, 0xFFFFFFFF, l.opaque));
+    }
+}
+
+/** Collects the jobs of all threads (in the order the threads submitted their first job) */
+static void _mergeSubmitBuffers(RenderQueue& q) {
+    std::lock_guard<std::mutex> lock(_submit_buffers_mutex);
+    for (auto& b : _submit_buffers) {
+        q.append(b->queue);
+        b->queue.clear();
+    }
 }
 
-static bool _rendersort(RenderJob& a, RenderJob& b) { return a.zDepth > b.zDepth; }
 void Engine::RenderAll() {
-    std::sort(_render_jobs.begin(), _render_jobs.end(), _rendersort);
+    ProfileZone("RenderAll");
+    _uploadCanvases();
+    _streamTextures();
+    if (_handOffFrame()) return;
+
+    _mergeSubmitBuffers(_render_queue);
+    _renderFrame();
+}
+
+void Engine::_renderFrame() {
+    RenderQueue& q = _render_queue;
+
+    // Every Draw... call is one quad, the jobs of the primitive layers are not counted
+    _frame_counting = FrameStats();
+    _frame_counting.jobs = (unsigned int)q.size();
+    for (size_t i = 0; i < q.primitiveLayers; i++)
+        _frame_counting.jobs += (unsigned int)(q.primitives[i].vertices.size() / 6);
+
+    _streamPrimitives(q);
+    unsigned int textureBinds = _gl.textureBinds;
+    unsigned int uniformUpdates = _gl.uniformUpdates;
+
+    // The result of this timer is from two frames ago, if it is not there yet keep the last known time
+    unsigned int timer = _gpu_timers[_gpu_timer_current];
+    double gpuTime = _frame_stats.gpuTime;
+    if (_gpu_timer_used[_gpu_timer_current]) {
+        GLint available = 0;
+        glGetQueryObjectiv(timer, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &ns);
+            gpuTime = (double)ns / 1000000.0;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, timer);
+
+    {
+        ProfileZone("RenderAll: cull + sort");
+        _sortJobs();
+    }
+
+    {
+        ProfileZone("RenderAll: build batches");
+        _buildBatches();
+    }
+
+    {
+        ProfileZone("RenderAll: draw");
+        for (auto& b : _render_batches) {
+            uint32_t first = _render_order[b.firstJob];
+            _gl.enableBlend(!_isOpaque(q, first));
+
+            switch (b.type) {
+                case RenderQueue::SHAPE: {
+                    ShapeSlot* shape = _shape_slots.get(q.subject[first]);
+                    if (shape) DrawShape2D(shape->shape, b.firstJob, b.jobCount);
+                } break;
+                case RenderQueue::TEXTURE:
+                    TextureDraw(b.firstJob, b.jobCount);
+                    break;
+                case RenderQueue::PRIMITIVES:
+                    _drawPrimitives(b.firstJob, q.subject[first]);
+                    break;
+            }
+        }
+    }
+
+    q.clear();
+
+    glEndQuery(GL_TIME_ELAPSED);
+    _gpu_timer_used[_gpu_timer_current] = true;
+    _gpu_timer_current ^= 1;
+
+    _frame_counting.culled = _culled_count;
+    _frame_counting.textureBinds = _gl.textureBinds - textureBinds;
+    _frame_counting.uniformUpdates = _gl.uniformUpdates - uniformUpdates;
+    _frame_counting.gpuTime = gpuTime;
+    {
+        std::lock_guard<std::mutex> lock(_frame_stats_mutex);
+        _frame_stats = _frame_counting;
+    }
+
+    ProfileZone("RenderAll: swap");
+    if (headless)
+        glFlush();  // There is nothing to show, the frame stays in the framebuffer until the next ClearScreen
+    else
+        SDL_GL_SwapWindow(window);
+}
+
+void Engine::_sortJobs() {
+    RenderQueue& q = _render_queue;
+
+    if (windowScale.x > 0 && windowScale.y > 0) {
+        // Everything inside the window (the play area and the bars next to it), in game coordinates
+        // (inverse of what universal.vert does: screen = pos * windowScale + windowOffset / 2)
+        _cullJobs(q,
+                  -windowOffset.x * 0.5f / windowScale.x,
+                  -windowOffset.y * 0.5f / windowScale.y,
+                  (windowSize.x - windowOffset.x * 0.5f) / windowScale.x,
+                  (windowSize.y - windowOffset.y * 0.5f) / windowScale.y,
+                  _render_order);
+
+        RG3GE::Core::RadixSortIndices(q.key.data(), _render_order, _render_order_scratch);
+    } else {
+        // The screen size is not known yet
+        _culled_count = 0;
+        RG3GE::Core::RadixSortIndices(q.key.data(), q.size(), _render_order, _render_order_scratch);
+    }
+}
+
+unsigned int Engine::batchCount() { return _batch_count; }
+unsigned int Engine::culledCount() { return _culled_count; }
+
+FrameStats Engine::frameStats() {
+    std::lock_guard<std::mutex> lock(_frame_stats_mutex);
+    return _frame_stats;
+}
+
+void Engine::SetOpaquePass(bool enable) { _opaque_pass = enable; }
+#pragma endregion
+
+//=============================================================================
+// Render Thread
+//   With EngineFlags::RENDER_THREAD the GL context belongs to a thread of its own.
+//   RenderAll() hands the recorded frame over as a packet and returns, while the
+//   render thread draws it. Only one packet can be in flight, so the game side
+//   is never more than one frame ahead.
+//-----------------------------------------------------------------------------
+//=============================================================================
+#pragma region Render Thread
+struct FramePacket {
+    RenderQueue queue;
+
+    // GL work, that was requested while recording the frame (ClearScreen, Destroy...)
+    // Runs on the render thread, before the jobs are drawn
+    std::vector<std::function<void()>> commands;
+};
+
+static struct {
+    std::thread thread;
+    std::thread::id id;
+    bool active = false;
+    bool stop = false;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    FramePacket packets[2];
+    FramePacket* recording = &packets[0];
+    FramePacket* pending = nullptr;  // handed over, but not drawn yet
+    bool commandsDone = true;
+
+    std::deque<std::function<void()>> calls;  // from _forwardToRenderThread
+} _rt;
+
+static bool _needsRenderThread() {
+    return _rt.active && std::this_thread::get_id() != _rt.id;
+}
+
+/** Blocks until the frame, that was handed over last, is drawn */
+static void _waitForRenderThread() {
+    if (!_needsRenderThread()) return;
+
+    std::unique_lock<std::mutex> lock(_rt.mutex);
+    _rt.cv.wait(lock, [] { return !_rt.pending; });
+}
+
+/**
+ * Runs fn on the render thread and waits for it to finish (it runs between two frames).
+ * \return - false = there is no render thread or this is the render thread, the caller has to do the work itself
+ */
+static bool _forwardToRenderThread(const std::function<void()>& fn) {
+    if (!_needsRenderThread()) return false;
+
+    std::unique_lock<std::mutex> lock(_rt.mutex);
+    bool done = false;
+    _rt.calls.push_back([&] {
+        fn();
+        std::lock_guard<std::mutex> l(_rt.mutex);
+        done = true;
+        _rt.cv.notify_all();
+    });
+    _rt.cv.notify_all();
+    _rt.cv.wait(lock, [&] { return done; });
+    return true;
+}
 
-    Color cs = Color(0.0f, 0.0f, 0.0f, 0.0f);
-    for (auto j : _render_jobs) {
-        if (cs != j.tint) {
-            cs = j.tint;
-            glUniform4f(shader.u_drawcolor, cs.r, cs.g, cs.b, cs.a);
+/**
+ * Records fn into the frame, that is currently build. It runs on the render thread,
+ * once the previous frame is drawn, but before the jobs of this frame are.
+ * \return - false = there is no render thread or this is the render thread, the caller has to do the work itself
+ */
+static bool _deferToRenderThread(std::function<void()> fn) {
+    if (!_needsRenderThread()) return false;
+
+    std::lock_guard<std::mutex> lock(_rt.mutex);
+    _rt.recording->commands.push_back(std::move(fn));
+    return true;
+}
+
+bool Engine::_handOffFrame() {
+    if (!_needsRenderThread()) return false;
+
+    ProfileZone("RenderAll: hand off");
+    std::unique_lock<std::mutex> lock(_rt.mutex);
+    _rt.cv.wait(lock, [] { return !_rt.pending; });
+
+    FramePacket* p = _rt.recording;
+    _mergeSubmitBuffers(p->queue);
+
+    _rt.recording = (p == &_rt.packets[0]) ? &_rt.packets[1] : &_rt.packets[0];
+    _rt.pending = p;
+    _rt.commandsDone = false;
+    _rt.cv.notify_all();
+
+    // The commands change the texture and shape slots, that SubmitForRender reads
+    // so the game side has to wait for them (but not for the drawing)
+    _rt.cv.wait(lock, [] { return _rt.commandsDone; });
+    return true;
+}
+
+void Engine::_renderThreadMain() {
+    std::unique_lock<std::mutex> lock(_rt.mutex);  // waits until _startRenderThread has set everything up
+    SDL_GL_MakeCurrent(window, context);
+    ProfileThreadName("Render Thread");
+
+    while (true) {
+        _rt.cv.wait(lock, [] { return _rt.stop || _rt.pending || !_rt.calls.empty(); });
+
+        while (!_rt.calls.empty()) {
+            auto call = std::move(_rt.calls.front());
+            _rt.calls.pop_front();
+            lock.unlock();
+            call();
+            lock.lock();
         }
-        switch (j.type) {
-            case 0:
-                DrawShape2D(j.subject.shape, j.tr, j.zDepth);
-                break;
-            case 1:
-                TextureDraw(j.subject.texture, j.tr, j.zDepth);
-                break;
+
+        if (_rt.pending) {
+            FramePacket* p = _rt.pending;
+            lock.unlock();
+
+            {
+                ProfileZone("Render Thread: commands");
+                for (auto& c : p->commands) c();
+                p->commands.clear();
+            }
+
+            lock.lock();
+            _rt.commandsDone = true;
+            _rt.cv.notify_all();
+            lock.unlock();
+
+            std::swap(_render_queue, p->queue);
+            _renderFrame();
+            std::swap(_render_queue, p->queue);
+
+            lock.lock();
+            _rt.pending = nullptr;
+            _rt.cv.notify_all();
+            continue;
         }
+
+        if (_rt.stop) break;
     }
+    lock.unlock();
 
-    _render_jobs.clear();
-    SDL_GL_SwapWindow(window);
+    SDL_GL_MakeCurrent(window, nullptr);
+}
+
+void Engine::_startRenderThread() {
+    for (auto& p : _rt.packets) p.queue.reserve(ENGINE_DRAW_CALL_LIMIT);
+
+    // The context can only be current on one thread
+    SDL_GL_MakeCurrent(window, nullptr);
+
+    std::lock_guard<std::mutex> lock(_rt.mutex);
+    _rt.stop = false;
+    _rt.active = true;
+    _rt.thread = std::thread(&Engine::_renderThreadMain, this);
+    _rt.id = _rt.thread.get_id();
+}
+
+void Engine::_stopRenderThread() {
+    if (!_rt.active) return;
+
+    {
+        std::lock_guard<std::mutex> lock(_rt.mutex);
+        _rt.stop = true;
+        _rt.cv.notify_all();
+    }
+    _rt.thread.join();  // the frame in flight is still drawn
+    _rt.active = false;
+
+    SDL_GL_MakeCurrent(window, context);
+
+    // Commands of the frame, that was never handed over, may still free resources
+    for (auto& c : _rt.recording->commands) c();
+    _rt.recording->commands.clear();
+    _rt.recording->queue.clear();
 }
 #pragma endregion
 
@@ -187,6 +1159,25 @@ Vertex2D::Vertex2D(float x, float y, Color c)
     : position(x, y), vertexColor(c), uvCoords(0.0f, 0.0f) {}
 Vertex2D::Vertex2D(float x, float y, float uvx, float uvy)
     : position(x, y), vertexColor(1.0f, 1.0f, 1.0f, 1.0f), uvCoords(uvx, uvy) {}
+
+static unsigned char _packUnorm8(float v) { return (unsigned char)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); }
+static unsigned short _packUnorm16(float v) { return (unsigned short)(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f); }
+
+PackedVertex2D::PackedVertex2D()
+    : position(0, 0), r(255), g(255), b(255), a(255), u(0), v(0) {}
+PackedVertex2D::PackedVertex2D(float x, float y)
+    : position(x, y), r(255), g(255), b(255), a(255), u(0), v(0) {}
+PackedVertex2D::PackedVertex2D(float x, float y, int r, int g, int b, int a)
+    : position(x, y), r((unsigned char)r), g((unsigned char)g), b((unsigned char)b), a((unsigned char)a), u(0), v(0) {}
+PackedVertex2D::PackedVertex2D(float x, float y, Color c)
+    : position(x, y), r(_packUnorm8(c.r)), g(_packUnorm8(c.g)), b(_packUnorm8(c.b)), a(_packUnorm8(c.a)), u(0), v(0) {}
+PackedVertex2D::PackedVertex2D(float x, float y, float uvx, float uvy)
+    : position(x, y), r(255), g(255), b(255), a(255), u(_packUnorm16(uvx)), v(_packUnorm16(uvy)) {}
+PackedVertex2D::PackedVertex2D(const Vertex2D& vertex)
+    : position(vertex.position),
+      r(_packUnorm8(vertex.vertexColor.r)), g(_packUnorm8(vertex.vertexColor.g)),
+      b(_packUnorm8(vertex.vertexColor.b)), a(_packUnorm8(vertex.vertexColor.a)),
+      u(_packUnorm16(vertex.uvCoords.x)), v(_packUnorm16(vertex.uvCoords.y)) {}
 #pragma endregion
 
 //=============================================================================
@@ -195,7 +1186,7 @@ Vertex2D::Vertex2D(float x, float y, float uvx, float uvy)
 //=============================================================================
 #pragma region RG3GE::Shape2D
 Shape2D::Shape2D()
-    : shape(PolyShapes::POINTS), vertexCnt(0), vertexBuffer(0) {}
+    : shape(PolyShapes::POINTS), format(VertexFormat::FLOAT), vertexCnt(0), firstVertex(0), vertexBuffer(0), vertexArray(0), id(-1) {}
 #pragma endregion
 
 //=============================================================================
@@ -210,12 +1201,28 @@ const Color Engine::BLACK = Color(0.0f, 0.0f, 0.0f, 1.0f);
 Engine* Engine::_instance = nullptr;
 
 Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned int sdl_init_flags, std::function<bool(const Engine*)> onBuild) {
+    return init(winWidth, winHeight, winTitle, EngineFlags::NONE, sdl_init_flags, onBuild);
+}
+
+Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, EngineFlags flags, unsigned int sdl_init_flags, std::function<bool(const Engine*)> onBuild) {
     if (_instance) {
         std::cout << "Engine::init can only run once per Application start" << std::endl
                   << "If the previous Engine has stopped, please restart the Application" << std::endl;
         return nullptr;
     }
 
+    bool headless = flags & EngineFlags::HEADLESS;
+
+    // Mesa picks llvmpipe, if these are set before the context is created (values set by the user win)
+    if (flags & EngineFlags::SOFTWARE_RENDERER) {
+        SDL_setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+        SDL_setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+    }
+
+    // Without a display server use SDLs offscreen (EGL) driver, otherwise just hide the window
+    if (headless && !SDL_getenv("DISPLAY") && !SDL_getenv("WAYLAND_DISPLAY"))
+        SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+
     if (SDL_Init(sdl_init_flags | SDL_INIT_VIDEO | SDL_INIT_TIMER)) {
         std::cout << SDL_GetError() << std::endl;
         return nullptr;
@@ -227,10 +1234,20 @@ Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned
 
     Engine* e = new Engine();
     _instance = e;
+    e->headless = headless;
+
+    // The context version has to be requested before the window is created
+    e->coreProfile = flags & EngineFlags::CORE_PROFILE;
+    if (e->coreProfile) {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    }
 
     e->window = SDL_CreateWindow(winTitle,
                                  SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                                 winWidth, winHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+                                 winWidth, winHeight,
+                                 headless ? (SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN) : (SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE));
     if (!e->window) {
         std::cout << "could not create window: " << SDL_GetError() << std::endl;
         return nullptr;
@@ -242,19 +1259,33 @@ Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned
         return nullptr;
     }
 
+    // Without this glew does not load the functions of core profiles
+    glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
         std::cout << "failed to setup glew " << std::endl;
         return nullptr;
     }
+    glGetError();  // glewInit trips a GL_INVALID_ENUM on core profiles
 
-    if (SDL_GL_SetSwapInterval(1) < 0) {
+    if (headless) {
+        // Nothing is shown, so frames are not bound to a display refresh (failing here does not matter)
+        SDL_GL_SetSwapInterval(0);
+
+        if (!e->_createOffscreenTarget(winWidth, winHeight)) {
+            std::cout << "could not create the offscreen framebuffer" << std::endl;
+            return nullptr;
+        }
+    } else if (SDL_GL_SetSwapInterval(1) < 0) {
         std::cout << "failed to setup vsync " << SDL_GetError() << std::endl;
         e->keepRunning = false;
         return nullptr;
     };
 
-    GLCALL(glLoadIdentity());
-    GLCALL(glOrtho(0, winWidth, winHeight, 0, -1, 1));
+    // The fixed function matrices do not exist in core profiles (the shaders do the projection anyway)
+    if (!e->coreProfile) {
+        GLCALL(glLoadIdentity());
+        GLCALL(glOrtho(0, winWidth, winHeight, 0, -1, 1));
+    }
     GLCALL(glEnable(GL_DEPTH_TEST));
 
     // Alpha Blending
@@ -264,23 +1295,24 @@ Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned
     e->windowSize = (Vec2<float>)Vec2<int>(winWidth, winHeight);
     e->origWindowSize = e->windowSize;
 
-    _render_jobs.reserve(ENGINE_DRAW_CALL_LIMIT);
+    _texture_slots.reserve(ENGINE_TEXTURE_LIMIT);
+    _render_queue.reserve(ENGINE_DRAW_CALL_LIMIT);
+    _render_order.reserve(ENGINE_DRAW_CALL_LIMIT);
+    _render_order_scratch.reserve(ENGINE_DRAW_CALL_LIMIT);
+    _render_batches.reserve(ENGINE_DRAW_CALL_LIMIT);
+    _job_transforms.reserve(ENGINE_DRAW_CALL_LIMIT);
 
     //Init OpenGLShaders
 #include "../shaders/universal.h"
     e->program = RG3GE::Core::CreateShader(universal_vs, universal_fs);
-    glUseProgram(e->program);
+    _gl.invalidate();
+    _gl.useProgram(e->program);
 
 #define srch_uni(f) e->shader.f = glGetUniformLocation(e->program, #f)
     srch_uni(u_shader_mode);
     srch_uni(u_screen);
-    srch_uni(u_translation);
-    srch_uni(u_origin);
-    srch_uni(u_zlayer);
-    srch_uni(u_angle);
-    srch_uni(u_scale);
-    srch_uni(u_textureCrop);
-    srch_uni(u_drawcolor);
+    srch_uni(u_transforms);
+    srch_uni(u_job);
     srch_uni(u_texture);
 #undef srch_uni
 
@@ -290,6 +1322,17 @@ Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned
     srch_attr(a_uvCoords);
 #undef srch_attr
 
+    // Textures are always bound to unit 0
+    _gl.uniform1i(e->shader.u_texture, 0);
+    _gl.uniform1i(e->shader.u_transforms, 1);
+
+    e->_createTransformBuffer();
+    e->_createPrimitiveBuffer();
+    GLCALL(glGenQueries(2, _gpu_timers));
+
+    // Headless windows never get resized, so the screen setup has to happen here
+    e->_applyScreenSize();
+
     Vertex2D pixeldata[] = {
         {0.0f, 0.0f, 0.0f, 0.0f},
         {1.0f, 0.0f, 1.0f, 0.0f},
@@ -300,6 +1343,9 @@ Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned
     Vertex2D linedata[] = {{0.0f, 0.0f}, {1.0f, 0.0f}};
     e->line = e->CreateShape2D(PolyShapes::LINES, 2, linedata);
 
+    e->ticks = SDL_GetPerformanceCounter();
+    if (flags & EngineFlags::RENDER_THREAD) e->_startRenderThread();
+
     if (onBuild(e)) {
         e->keepRunning = true;
         return e;
@@ -311,11 +1357,14 @@ Engine* Engine::init(int winWidth, int winHeight, const char* winTitle, unsigned
 void Engine::cleanup() {
     // Free all texture Slots
     if (_instance) {
-        for (int a = 0; a < ENGINE_TEXTURE_LIMIT; a++) {
-            if (_texture_slots[a].colorchannels > 0) {
-                _instance->freeTextureSlot(a, true);
-            }
-        }
+        // From here on everything runs on this thread again
+        _instance->_stopRenderThread();
+        _stopTextureLoads();
+
+        std::vector<int> handles;
+        _texture_slots.forEach([&](int handle, TextureSlot&) { handles.push_back(handle); });
+        for (int handle : handles)
+            _instance->freeTextureSlot(handle, true);
 
         delete _instance;
     }
@@ -324,19 +1373,42 @@ void Engine::cleanup() {
 }
 
 Engine::Engine()
-    : borderColor(Engine::BLACK), currentTint(1.0f, 1.0f, 1.0f, 1.0f), _deltaTime(0.0f), windowSize(0), origWindowSize(0), windowOffset(0), windowScale(0), ticks(0) {}
+    : borderColor(Engine::BLACK), coreProfile(false), headless(false), _deltaTime(0.0f), windowSize(0), origWindowSize(0), windowOffset(0), windowScale(0), ticks(0) {}
 
 Engine::~Engine() {
     DestroyShape2D(pixel);
+    DestroyShape2D(line);
+
+    GLCALL(glDeleteQueries(2, _gpu_timers));
+    if (_offscreen_fbo) {
+        GLCALL(glDeleteFramebuffers(1, &_offscreen_fbo));
+        GLCALL(glDeleteRenderbuffers(2, _offscreen_buffers));
+    }
+    GLCALL(glDeleteTextures(1, &_transform_texture));
+    if (_placeholder_texture) GLCALL(glDeleteTextures(1, &_placeholder_texture));
+    if (_texture_upload_buffer) GLCALL(glDeleteBuffers(1, &_texture_upload_buffer));
+    GLCALL(glDeleteBuffers(1, &_transform_buffer));
+    GLCALL(glDeleteVertexArrays(1, &_primitive_vertex_array));
+    GLCALL(glDeleteBuffers(1, &_primitive_buffer));
+    for (auto& p : _index_patterns)
+        if (p.buffer) GLCALL(glDeleteBuffers(1, &p.buffer));
+    for (auto& g : _geometry_blocks) {
+        if (!g.buffer) continue;
+        GLCALL(glDeleteVertexArrays(1, &g.vertexArray));
+        GLCALL(glDeleteBuffers(1, &g.buffer));
+    }
+    _geometry_blocks.clear();
 
     if (context) SDL_GL_DeleteContext(context);
     if (window) SDL_DestroyWindow(window);
 }
 
 bool Engine::windowTick() {
-    Uint32 currentTicks = SDL_GetTicks();
-    Uint32 deltaTicks = currentTicks - ticks;
-    _deltaTime = (float)deltaTicks / 1000.0f;
+    ProfileZone("windowTick");
+    // The high resolution counter, so frames faster than 1ms (headless / no vsync) still advance
+    Uint64 currentTicks = SDL_GetPerformanceCounter();
+    Uint64 deltaTicks = currentTicks - ticks;
+    _deltaTime = (float)((double)deltaTicks / (double)SDL_GetPerformanceFrequency());
 
     if (_deltaTime > 0) {
         for (auto it : keys_pressed)
@@ -350,55 +1422,63 @@ bool Engine::windowTick() {
         mouse_pressed.clear();
         mouse_released.clear();
 
-        while (keepRunning && SDL_PollEvent(&event)) {
-            switch (event.type) {
-                    // TODO: Process other events
-                case SDL_QUIT:
-                    keepRunning = false;
-                    break;
-
-                case SDL_MOUSEBUTTONDOWN: {
-                    mouse_pressed.emplace(event.button.button);
-                } break;
-
-                case SDL_MOUSEBUTTONUP: {
-                    mouse_released.emplace(event.button.button);
-                    auto it = mouse_held.find(event.key.keysym.sym);
-                    if (it != mouse_held.end()) mouse_held.erase(it);
-                } break;
-
-                case SDL_MOUSEMOTION: {
-                    mousePosition.x = (float)event.motion.x;
-                    mousePosition.y = (float)event.motion.y;
-                    mousePosition -= windowOffset / 2;
-                    mousePosition /= windowScale;
-                } break;
-
-                case SDL_KEYDOWN: {
-                    if (event.key.keysym.sym != last_pressed)
-                        keys_pressed.emplace(event.key.keysym.sym);
-
-                    last_pressed = event.key.keysym.sym;
-                } break;
-
-                case SDL_KEYUP: {
-                    keys_released.emplace(event.key.keysym.sym);
-                    auto it = keys_held.find(event.key.keysym.sym);
-                    if (it != keys_held.end()) keys_held.erase(it);
-
-                    if (event.key.keysym.sym == last_pressed) last_pressed = 0;
-                } break;
-
-                case SDL_WINDOWEVENT:
-                    switch (event.window.event) {
-                        case SDL_WINDOWEVENT_RESIZED:
-                            windowSize = (Vec2<float>)Vec2<int>(event.window.data1, event.window.data2);
-                            _applyScreenSize();
-                            break;
-                    }
-                    break;
-            }
-        };
+        {
+            ProfileZone("windowTick: events");
+            while (keepRunning && SDL_PollEvent(&event)) {
+                switch (event.type) {
+                        // TODO: Process other events
+                    case SDL_QUIT:
+                        keepRunning = false;
+                        break;
+
+                    case SDL_MOUSEBUTTONDOWN: {
+                        mouse_pressed.emplace(event.button.button);
+                    } break;
+
+                    case SDL_MOUSEBUTTONUP: {
+                        mouse_released.emplace(event.button.button);
+                        auto it = mouse_held.find(event.key.keysym.sym);
+                        if (it != mouse_held.end()) mouse_held.erase(it);
+                    } break;
+
+                    case SDL_MOUSEMOTION: {
+                        mousePosition.x = (float)event.motion.x;
+                        mousePosition.y = (float)event.motion.y;
+                        mousePosition -= windowOffset / 2;
+                        mousePosition /= windowScale;
+                    } break;
+
+                    case SDL_KEYDOWN: {
+                        if (event.key.keysym.sym != last_pressed)
+                            keys_pressed.emplace(event.key.keysym.sym);
+
+                        last_pressed = event.key.keysym.sym;
+                    } break;
+
+                    case SDL_KEYUP: {
+                        keys_released.emplace(event.key.keysym.sym);
+                        auto it = keys_held.find(event.key.keysym.sym);
+                        if (it != keys_held.end()) keys_held.erase(it);
+
+                        if (event.key.keysym.sym == last_pressed) last_pressed = 0;
+                    } break;
+
+                    case SDL_WINDOWEVENT:
+                        switch (event.window.event) {
+                            case SDL_WINDOWEVENT_RESIZED: {
+                                // windowScale and windowOffset are used while drawing, so they can only change between frames
+                                Vec2<float> size = (Vec2<float>)Vec2<int>(event.window.data1, event.window.data2);
+                                auto resize = [this, size] {
+                                    windowSize = size;
+                                    _applyScreenSize();
+                                };
+                                if (!_forwardToRenderThread(resize)) resize();
+                            } break;
+                        }
+                        break;
+                }
+            };
+        }
 
         if (keepRunning) {
             //TODO: Update World
@@ -408,6 +1488,8 @@ bool Engine::windowTick() {
         if (keepRunning) {
             //TODO: Update Viewport
 
+            ProfileZone("windowTick: letterbox + render");
+
             // Draw some nice bars, if window aspect does not fit viewport aspect
             SetTint(borderColor);
             //TODO: Move to _applyScreenSize
@@ -446,22 +1528,71 @@ float Engine::deltaTime() {
 }
 
 void Engine::SetTint(Color c) {
-    currentTint = c;
+    _submitBuffer().tint = c;
 }
 
 void Engine::ClearScreen(Color c) {
+    if (_deferToRenderThread([this, c] { ClearScreen(c); })) return;
+
     glClearColor(c.r, c.g, c.b, c.a);
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 }
 
-void Engine::resizeWindow(int newWidth, int newHeight) {
-    if (newWidth > 0 && newHeight > 0) {
-        SDL_SetWindowSize(window, newWidth, newHeight);
+void Engine::resizeWindow(int newWidth, int newHeight) {
+    if (newWidth > 0 && newHeight > 0) {
+        SDL_SetWindowSize(window, newWidth, newHeight);
+    }
+}
+
+bool Engine::_createOffscreenTarget(int width, int height) {
+    GLCALL(glGenFramebuffers(1, &_offscreen_fbo));
+    GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, _offscreen_fbo));
+
+    GLCALL(glGenRenderbuffers(2, _offscreen_buffers));
+    GLCALL(glBindRenderbuffer(GL_RENDERBUFFER, _offscreen_buffers[0]));
+    GLCALL(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+    GLCALL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _offscreen_buffers[0]));
+
+    GLCALL(glBindRenderbuffer(GL_RENDERBUFFER, _offscreen_buffers[1]));
+    GLCALL(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height));
+    GLCALL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _offscreen_buffers[1]));
+
+    // Stays bound, everything is drawn into it from here on
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+bool Engine::CaptureFrame(std::vector<unsigned char>& rgba) {
+    _waitForRenderThread();
+
+    bool ok = false;
+    if (_forwardToRenderThread([&] { ok = CaptureFrame(rgba); })) return ok;
+
+    int w = (int)windowSize.x, h = (int)windowSize.y;
+    if (w <= 0 || h <= 0) return false;
+    rgba.resize((size_t)w * h * 4);
+
+    // Windows have already swapped the frame to the front
+    if (!headless) GLCALL(glReadBuffer(GL_FRONT));
+    GLCALL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GLCALL(glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data()));
+    if (!headless) GLCALL(glReadBuffer(GL_BACK));
+
+    // OpenGL starts with the bottom row
+    size_t row = (size_t)w * 4;
+    std::vector<unsigned char> tmp(row);
+    for (int y = 0; y < h / 2; y++) {
+        unsigned char* a = &rgba[y * row];
+        unsigned char* b = &rgba[(h - 1 - y) * row];
+        std::copy(a, a + row, tmp.data());
+        std::copy(b, b + row, a);
+        std::copy(tmp.data(), tmp.data() + row, b);
     }
+
+    return true;
 }
 
 void Engine::_applyScreenSize() {
-    GLCALL(glUniform2f(shader.u_screen, (float)windowSize.x, (float)windowSize.y));
+    GLCALL(_gl.uniform2f(shader.u_screen, (float)windowSize.x, (float)windowSize.y));
 
     Vec2<float> scale = (Vec2<float>)windowSize / (Vec2<float>)origWindowSize;
     if (scale.x > scale.y)
@@ -477,17 +1608,6 @@ void Engine::_applyScreenSize() {
     GLCALL(glViewport(0, 0, (int)windowSize.x, (int)windowSize.y));
 }
 
-void Engine::_applyTransform(Transform& transform, float zLayer) {
-    Vec2<float> rot = (Vec2<float>)transform.rotation.direction;
-    Vec2<float> loc = transform.position * 2.0f * windowScale + windowOffset;
-
-    glUniform2f(shader.u_translation, loc.x, loc.y);
-    glUniform2f(shader.u_angle, rot.x, rot.y);
-
-    glUniform2f(shader.u_origin, transform.origin.x, transform.origin.y);
-    glUniform1f(shader.u_zlayer, zLayer);
-    glUniform2f(shader.u_scale, transform.scale.x * 2 * windowScale.x, transform.scale.y * 2 * windowScale.y);
-}
 #pragma endregion
 
 //=============================================================================
@@ -511,117 +1631,416 @@ bool Engine::mouseReleased(Uint8 code) { return mouse_released.find(code) != mou
 //-----------------------------------------------------------------------------
 //=============================================================================
 #pragma region RG3GE::Engine::Shape2D - Functions
-Shape2D Engine::CreateShape2D(RG3GE::PolyShapes shape, const std::vector<Vertex2D>& data) {
-    Vertex2D* points = (Vertex2D*)alloca(sizeof(Vertex2D) * data.size());
+template <typename V>
+static bool _verticesOpaque(const V* points, int verts) {
+    for (int i = 0; i < verts; i++) {
+        if constexpr (std::is_same_v<V, PackedVertex2D>) {
+            if (points[i].a < 255) return false;
+        } else if (points[i].vertexColor.a < 1.0f)
+            return false;
+    }
+    return true;
+}
+
+static bool _verticesOpaque(const void* points, int verts, VertexFormat format) {
+    return format == VertexFormat::PACKED ? _verticesOpaque((const PackedVertex2D*)points, verts)
+                                          : _verticesOpaque((const Vertex2D*)points, verts);
+}
+
+/** Sets the culling box of the shape to the vertices (reset = false grows the current box instead) */
+template <typename V>
+static void _updateShapeBounds(ShapeSlot* slot, const V* points, int verts, bool reset) {
+    if (verts <= 0) return;
+
+    if (reset) {
+        slot->minX = slot->maxX = points[0].position.x;
+        slot->minY = slot->maxY = points[0].position.y;
+    }
 
-    int cnt = 0;
-    for (auto p : data) {
-        points[cnt] = p;
-        cnt++;
+    for (int i = 0; i < verts; i++) {
+        slot->minX = std::min(slot->minX, points[i].position.x);
+        slot->minY = std::min(slot->minY, points[i].position.y);
+        slot->maxX = std::max(slot->maxX, points[i].position.x);
+        slot->maxY = std::max(slot->maxY, points[i].position.y);
     }
+}
+
+static void _updateShapeBounds(ShapeSlot* slot, const void* points, int verts, bool reset) {
+    if (slot->shape.format == VertexFormat::PACKED)
+        _updateShapeBounds(slot, (const PackedVertex2D*)points, verts, reset);
+    else
+        _updateShapeBounds(slot, (const Vertex2D*)points, verts, reset);
+}
 
-    return CreateShape2D(shape, cnt, points);
+Shape2D Engine::CreateShape2D(RG3GE::PolyShapes shape, const std::vector<Vertex2D>& data) {
+    return _createShape2D(shape, (int)data.size(), data.data(), VertexFormat::FLOAT);
 }
 
 Shape2D Engine::CreateShape2D(RG3GE::PolyShapes shape, int verts, const Vertex2D points[]) {
+    return _createShape2D(shape, verts, points, VertexFormat::FLOAT);
+}
+
+Shape2D Engine::CreateShape2D(RG3GE::PolyShapes shape, std::span<const PackedVertex2D> data) {
+    return _createShape2D(shape, (int)data.size(), data.data(), VertexFormat::PACKED);
+}
+
+Shape2D Engine::CreateShape2D(RG3GE::PolyShapes shape, int verts, const PackedVertex2D points[]) {
+    return _createShape2D(shape, verts, points, VertexFormat::PACKED);
+}
+
+Shape2D Engine::_createShape2D(RG3GE::PolyShapes shape, int verts, const void* points, VertexFormat format) {
+    Shape2D fwd;
+    if (_forwardToRenderThread([&] { fwd = _createShape2D(shape, verts, points, format); })) return fwd;
+
     Shape2D ret;
     ret.vertexCnt = verts;
     ret.shape = shape;
+    ret.format = format;
+
+    ret.id = _shape_slots.allocate();
+    if (ret.id == -1) {
+        std::cout << "no free shape slots available" << std::endl;
+        return ret;
+    }
 
-    // TODO: Keep track of all created buffers inside Engine::_instance (then clean out on delete)
-    GLCALL(glGenBuffers(1, &ret.vertexBuffer));
-    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, ret.vertexBuffer));
-    GLCALL(glBufferData(GL_ARRAY_BUFFER, verts * sizeof(Vertex2D), points, GL_DYNAMIC_DRAW));
+    int block = -1;
+    if (verts > 0) {
+        block = _geometryAllocate(verts, format, ret.firstVertex);
+
+        GeometryBlock& g = _geometry_blocks[block];
+        ret.vertexBuffer = g.buffer;
+        ret.vertexArray = g.vertexArray;
+
+        size_t size = _vertexSize(format);
+        GLCALL(_gl.bindArrayBuffer(g.buffer));
+        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, ret.firstVertex * size, verts * size, points));
+    }
+
+    // Core profiles have no QUADS, QUAD_STRIP or POLYGON, so these get drawn through a shared index pattern
+    int pattern = coreProfile ? _indexPatternOf(shape) : -1;
+    if (pattern >= 0) _reserveIndexPattern(pattern, verts);
+
+    ShapeSlot* slot = _shape_slots.get(ret.id);
+    slot->shape = ret;
+    slot->block = block;
+    slot->opaque = _verticesOpaque(points, verts, format);
+    _updateShapeBounds(slot, points, verts, true);
 
     return ret;
 };
 
+bool Engine::UpdateShape2D(Shape2D& shape, std::span<const Vertex2D> vertices) {
+    return _updateShape2D(shape, 0, vertices.data(), (int)vertices.size(), VertexFormat::FLOAT, true);
+}
+
+bool Engine::UpdateShape2D(Shape2D& shape, int firstVertex, std::span<const Vertex2D> vertices) {
+    return _updateShape2D(shape, firstVertex, vertices.data(), (int)vertices.size(), VertexFormat::FLOAT, false);
+}
+
+bool Engine::UpdateShape2D(Shape2D& shape, std::span<const PackedVertex2D> vertices) {
+    return _updateShape2D(shape, 0, vertices.data(), (int)vertices.size(), VertexFormat::PACKED, true);
+}
+
+bool Engine::UpdateShape2D(Shape2D& shape, int firstVertex, std::span<const PackedVertex2D> vertices) {
+    return _updateShape2D(shape, firstVertex, vertices.data(), (int)vertices.size(), VertexFormat::PACKED, false);
+}
+
+bool Engine::_updateShape2D(Shape2D& shape, int first, const void* points, int cnt, VertexFormat format, bool replace) {
+    ShapeSlot* slot = _shape_slots.get(shape.id);
+    if (!slot) {
+        Debug("Warning!!! : shape was not created via CreateShape2D or is already destroyed");
+        return false;
+    }
+
+    if (format != slot->shape.format) {
+        Debug("Warning!!! : the vertices have a different VertexFormat than the shape");
+        return false;
+    }
+
+    if (!replace) {
+        // shape.vertexCnt instead of the slot, that may still wait for an update, that was recorded for the render thread
+        if (first < 0 || first + cnt > shape.vertexCnt) {
+            Debug("Warning!!! : vertex range is outside of the shape");
+            return false;
+        }
+        if (cnt == 0) return true;
+    }
+
+    // SubmitForRender reads this on the submitting thread (a partial update can only make it less opaque)
+    bool opaque = _verticesOpaque(points, cnt, format);
+    slot->opaque = replace ? opaque : slot->opaque && opaque;
+    if (replace) shape.vertexCnt = cnt;
+
+    if (slot->dynamic) {
+        // The shapes buffer stays the same, so the upload can wait for the render thread
+        const unsigned char* bytes = (const unsigned char*)points;
+        std::vector<unsigned char> copy(bytes, bytes + cnt * _vertexSize(format));
+        if (_deferToRenderThread([this, id = shape.id, first, copy, cnt, replace] { _applyShapeUpdate(id, first, copy.data(), cnt, replace); }))
+            return true;
+    } else if (_forwardToRenderThread([&] { _applyShapeUpdate(shape.id, first, points, cnt, replace); })) {
+        shape = _shape_slots.get(shape.id)->shape;
+        return true;
+    }
+
+    _applyShapeUpdate(shape.id, first, points, cnt, replace);
+    shape = _shape_slots.get(shape.id)->shape;
+    return true;
+}
+
+void Engine::_applyShapeUpdate(int id, int first, const void* points, int cnt, bool replace) {
+    ShapeSlot* slot = _shape_slots.get(id);
+    if (!slot) return;  // destroyed, before the render thread got to it
+
+    Shape2D& s = slot->shape;
+    size_t size = _vertexSize(s.format);
+    bool newBlock = !slot->dynamic;
+
+    if (!slot->dynamic) {
+        // Writing into the shared block would wait for every frame, that still draws something from it
+        int oldBlock = slot->block, oldFirst = s.firstVertex, oldCnt = s.vertexCnt;
+        int block = _geometryAllocate(std::max(replace ? cnt : oldCnt, 1), s.format, s.firstVertex, true);
+        GeometryBlock& g = _geometry_blocks[block];
+
+        if (!replace) {
+            // Keeps the vertices, that are not part of the update
+            GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, _geometry_blocks[oldBlock].buffer));
+            GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, g.buffer));
+            GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                       oldFirst * size, 0, oldCnt * size));
+            GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+            GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+        }
+
+        _geometryFree(oldBlock, oldFirst, oldCnt);
+        slot->block = block;
+        slot->dynamic = true;
+        s.vertexBuffer = g.buffer;
+        s.vertexArray = g.vertexArray;
+    }
+
+    GeometryBlock& g = _geometry_blocks[slot->block];
+    GLCALL(_gl.bindArrayBuffer(g.buffer));
+
+    if (replace) {
+        // New storage for the buffer (orphaning), frames that are still in flight keep the old one
+        // (a block, that was just created, has fresh storage already)
+        if (newBlock)
+            GLCALL(glBufferSubData(GL_ARRAY_BUFFER, 0, cnt * size, points));
+        else
+            GLCALL(glBufferData(GL_ARRAY_BUFFER, cnt * size, points, GL_STREAM_DRAW));
+        g.heap.reset(cnt);
+        g.heap.allocate(cnt);
+        s.firstVertex = 0;
+        s.vertexCnt = cnt;
+
+        int pattern = coreProfile ? _indexPatternOf(s.shape) : -1;
+        if (pattern >= 0) _reserveIndexPattern(pattern, cnt);
+    } else {
+        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, (s.firstVertex + first) * size, cnt * size, points));
+    }
+
+    _updateShapeBounds(slot, points, cnt, replace);
+}
+
 void Engine::DestroyShape2D(Shape2D s) {
-    GLCALL(glDeleteBuffers(1, &s.vertexBuffer));
-    s.vertexBuffer = 0;
+    if (_deferToRenderThread([this, s] { DestroyShape2D(s); })) return;
+
+    ShapeSlot* slot = _shape_slots.get(s.id);
+    if (!slot) {
+        Debug("Warning!!! : shape was not created via CreateShape2D or is already destroyed");
+        return;
+    }
+
+    _geometryFree(slot->block, slot->shape.firstVertex, slot->shape.vertexCnt);
+    _shape_slots.release(s.id);
 }
 
-void Engine::DrawShape2D(Shape2D shape, Transform& tr, float zLayer) {
-    glUniform1i(shader.u_shader_mode, 0);
+/**
+ * Finds room for the vertices inside the geometry heap (creates a new block, if none has room left).
+ *
+ * \param first - receives the first vertex of the range inside the block
+ * \param dedicated - true = the range gets a new block, that no other shape uses
+ * \return - index of the block
+ */
+int Engine::_geometryAllocate(int verts, VertexFormat format, int& first, bool dedicated) {
+    for (size_t b = 0; b < _geometry_blocks.size() && !dedicated; b++) {
+        GeometryBlock& g = _geometry_blocks[b];
+        if (!g.buffer || g.dedicated || g.format != format) continue;
+        first = g.heap.allocate(verts);
+        if (first >= 0) return (int)b;
+    }
+
+    int block = -1;
+    for (size_t b = 0; b < _geometry_blocks.size() && block == -1; b++)
+        if (!_geometry_blocks[b].buffer) block = (int)b;
+
+    if (block == -1) {
+        block = (int)_geometry_blocks.size();
+        _geometry_blocks.emplace_back();
+    }
 
-    glEnableVertexAttribArray(shader.a_position);
-    glEnableVertexAttribArray(shader.a_color);
-    glEnableVertexAttribArray(shader.a_uvCoords);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glPushMatrix();
+    // Shapes, that do not fit into a regular block, get one of their own
+    GeometryBlock& g = _geometry_blocks[block];
+    g.dedicated = dedicated || verts > ENGINE_GEOMETRY_HEAP_VERTICES;
+    g.format = format;
+    int capacity = g.dedicated ? verts : ENGINE_GEOMETRY_HEAP_VERTICES;
+    g.heap.reset(capacity);
 
-    _applyTransform(tr, zLayer);
+    GLCALL(glGenBuffers(1, &g.buffer));
+    GLCALL(_gl.bindArrayBuffer(g.buffer));
+    GLCALL(glBufferData(GL_ARRAY_BUFFER, capacity * _vertexSize(format), nullptr, GL_DYNAMIC_DRAW));
 
-    glBindBuffer(GL_ARRAY_BUFFER, shape.vertexBuffer);
-    glVertexPointer(2, GL_FLOAT, 0, NULL);
-    glVertexAttribPointer(shader.a_position, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), 0);
-    glVertexAttribPointer(shader.a_color, 4, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), (void*)(2 * sizeof(GL_FLOAT)));
-    glVertexAttribPointer(shader.a_uvCoords, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), (void*)(6 * sizeof(GL_FLOAT)));
-    glDrawArrays(static_cast<GLint>(shape.shape), 0, shape.vertexCnt);
+    // The vertex array remembers the attribute setup, so drawing only needs to bind it
+    GLCALL(glGenVertexArrays(1, &g.vertexArray));
+    _gl.bindVertexArray(g.vertexArray);
+    _setupVertex2DAttributes(format);
 
-    glPopMatrix();
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableVertexAttribArray(shader.a_position);
-    glDisableVertexAttribArray(shader.a_color);
-    glDisableVertexAttribArray(shader.a_uvCoords);
+    first = g.heap.allocate(verts);
+    return block;
 }
-#pragma endregion
 
-//=============================================================================
-// RG3GE::Engine::Draw... - Functions
-//-----------------------------------------------------------------------------
-//=============================================================================
-#pragma region RG3GE::Engine::Draw... - Functions
-void Engine::DrawRectFilled(int x, int y, int w, int h, Color c, float zLayer) {
-    Color t = currentTint;
+void Engine::_setupVertex2DAttributes(VertexFormat format) {
+    GLCALL(glEnableVertexAttribArray(shader.a_position));
+    GLCALL(glEnableVertexAttribArray(shader.a_color));
+    GLCALL(glEnableVertexAttribArray(shader.a_uvCoords));
+
+    if (format == VertexFormat::PACKED) {
+        // Color and uv are normalized integers, the shader still gets them as 0 - 1 floats
+        GLCALL(glVertexAttribPointer(shader.a_position, 2, GL_FLOAT, GL_FALSE, sizeof(PackedVertex2D), (void*)offsetof(PackedVertex2D, position)));
+        GLCALL(glVertexAttribPointer(shader.a_color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex2D), (void*)offsetof(PackedVertex2D, r)));
+        GLCALL(glVertexAttribPointer(shader.a_uvCoords, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex2D), (void*)offsetof(PackedVertex2D, u)));
+        return;
+    }
 
-    currentTint = c;
-    Transform tr = {
-        (Vec2<float>)Vec2<int>(x, y),
-        {0},
-        (Vec2<float>)Vec2<int>(w, h),
-        0};
-    SubmitForRender(pixel, tr, zLayer);
-    currentTint = t;
+    GLCALL(glVertexAttribPointer(shader.a_position, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), 0));
+    GLCALL(glVertexAttribPointer(shader.a_color, 4, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), (void*)(2 * sizeof(GL_FLOAT))));
+    GLCALL(glVertexAttribPointer(shader.a_uvCoords, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), (void*)(6 * sizeof(GL_FLOAT))));
 }
 
-void Engine::DrawLine(int startx, int starty, int endx, int endy, Color c, int thickness, float zLayer) {
-    Color t = currentTint;
-    currentTint = c;
+void Engine::DrawShape2D(Shape2D shape, int entry, int count) {
+    if (shape.vertexCnt <= 0) return;
+
+    _gl.uniform1i(shader.u_shader_mode, 0);
+    _gl.uniform1i(shader.u_job, entry);
+
+    _gl.bindVertexArray(shape.vertexArray);
+    _drawShapeGeometry(shape, count);
+}
+
+void Engine::_drawShapeGeometry(const Shape2D& shape, int instanceCount) {
+    int pattern = coreProfile ? _indexPatternOf(shape.shape) : -1;
+
+    _frame_counting.drawCalls++;
+    _frame_counting.vertices += shape.vertexCnt * instanceCount;
+
+    if (pattern >= 0) {
+        // The vertex array belongs to the whole geometry block, so the pattern is bound per draw
+        // and the base vertex moves the pattern onto the shapes range
+        int cnt = _indexPatternCount(pattern, shape.vertexCnt);
+        GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_patterns[pattern].buffer));
+        if (instanceCount == 1)
+            glDrawElementsBaseVertex(GL_TRIANGLES, cnt, GL_UNSIGNED_INT, 0, shape.firstVertex);
+        else
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cnt, GL_UNSIGNED_INT, 0, instanceCount, shape.firstVertex);
+        return;
+    }
+
+    if (instanceCount == 1)
+        glDrawArrays(static_cast<GLint>(shape.shape), shape.firstVertex, shape.vertexCnt);
+    else
+        glDrawArraysInstanced(static_cast<GLint>(shape.shape), shape.firstVertex, shape.vertexCnt, instanceCount);
+}
 
-    Vec2<double> delta = {
-        (double)endx - (double)startx,
-        (double)endy - (double)starty};
+void Engine::_createPrimitiveBuffer() {
+    _primitive_capacity = 6 * ENGINE_DRAW_CALL_LIMIT;  // enough for ENGINE_DRAW_CALL_LIMIT quads
 
-    double ang = atan2(delta.y, delta.x) * (360.0 / PI2);
+    GLCALL(glGenBuffers(1, &_primitive_buffer));
+    GLCALL(_gl.bindArrayBuffer(_primitive_buffer));
+    GLCALL(glBufferData(GL_ARRAY_BUFFER, _primitive_capacity * sizeof(PackedVertex2D), nullptr, GL_STREAM_DRAW));
 
-    delta *= delta;
-    double scale = std::sqrt(delta.x + delta.y);
+    GLCALL(glGenVertexArrays(1, &_primitive_vertex_array));
+    _gl.bindVertexArray(_primitive_vertex_array);
+    _setupVertex2DAttributes(VertexFormat::PACKED);
+}
 
-    Transform tr = {
-        (Vec2<float>)Vec2<int>(startx, starty),
-        {0, (float)round(thickness / 2) + 1.0f},
-        {(float)scale, (float)thickness},
-        ang};
+void Engine::_drawPrimitives(int entry, uint32_t layer) {
+    PrimitiveRange& r = _primitive_ranges[layer];
+    if (r.count <= 0) return;
 
-    SubmitForRender(pixel, tr, zLayer);
+    _gl.uniform1i(shader.u_shader_mode, 0);
+    _gl.uniform1i(shader.u_job, entry);
+    _gl.bindVertexArray(_primitive_vertex_array);
 
-    currentTint = t;
+    _frame_counting.drawCalls++;
+    _frame_counting.vertices += r.count;
+    glDrawArrays(GL_TRIANGLES, r.first, r.count);
 }
 
-void Engine::DrawPixel(int x, int y, Color c, float zLayer) {
-    Color t = currentTint;
-    currentTint = c;
+void Engine::_createTransformBuffer() {
+    GLCALL(glGenBuffers(1, &_transform_buffer));
+    GLCALL(glBindBuffer(GL_TEXTURE_BUFFER, _transform_buffer));
+    GLCALL(glBufferData(GL_TEXTURE_BUFFER, ENGINE_DRAW_CALL_LIMIT * sizeof(JobTransform), nullptr, GL_STREAM_DRAW));
+
+    // Texture unit 1 is reserved for it (everything else uses unit 0)
+    GLCALL(glGenTextures(1, &_transform_texture));
+    GLCALL(glActiveTexture(GL_TEXTURE1));
+    GLCALL(glBindTexture(GL_TEXTURE_BUFFER, _transform_texture));
+    GLCALL(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _transform_buffer));
+    GLCALL(glActiveTexture(GL_TEXTURE0));
+}
+#pragma endregion
 
-    Transform tr = {
-        (Vec2<float>)Vec2<int>(x, y),
-        {0.0f},
-        {1.0f},
-        0.0f};
+//=============================================================================
+// RG3GE::Engine::Draw... - Functions
+//-----------------------------------------------------------------------------
+//=============================================================================
+#pragma region RG3GE::Engine::Draw... - Functions
+/** Adds the quad (corners in order around it) as two triangles to the primitive layer */
+static void _pushPrimitiveQuad(float zLayer, Color c,
+                               float x0, float y0, float x1, float y1,
+                               float x2, float y2, float x3, float y3) {
+    RenderQueue::PrimitiveLayer& l = _submitBuffer().queue.primitiveLayer(zLayer);
+
+    PackedVertex2D v(0.0f, 0.0f, c);
+    l.opaque = l.opaque && v.a == 255;
+
+    auto corner = [&](float x, float y) {
+        v.position.x = x;
+        v.position.y = y;
+        l.vertices.push_back(v);
+    };
+    corner(x0, y0);
+    corner(x1, y1);
+    corner(x2, y2);
+    corner(x0, y0);
+    corner(x2, y2);
+    corner(x3, y3);
+}
+
+void Engine::DrawRectFilled(int x, int y, int w, int h, Color c, float zLayer) {
+    float x0 = (float)x, y0 = (float)y;
+    float x1 = (float)(x + w), y1 = (float)(y + h);
+    _pushPrimitiveQuad(zLayer, c, x0, y0, x1, y0, x1, y1, x0, y1);
+}
 
-    SubmitForRender(pixel, tr, zLayer);
+void Engine::DrawLine(int startx, int starty, int endx, int endy, Color c, int thickness, float zLayer) {
+    float dx = (float)(endx - startx);
+    float dy = (float)(endy - starty);
+    float len = std::sqrt(dx * dx + dy * dy);
+    if (len <= 0.0f) return;
+
+    // Runs through the pixel centers, thickness / 2 to each side
+    float nx = -dy / len * thickness * 0.5f;
+    float ny = dx / len * thickness * 0.5f;
+    float sx = startx + 0.5f, sy = starty + 0.5f;
+    float ex = endx + 0.5f, ey = endy + 0.5f;
+
+    _pushPrimitiveQuad(zLayer, c, sx + nx, sy + ny, ex + nx, ey + ny, ex - nx, ey - ny, sx - nx, sy - ny);
+}
 
-    currentTint = t;
+void Engine::DrawPixel(int x, int y, Color c, float zLayer) {
+    float x0 = (float)x, y0 = (float)y;
+    _pushPrimitiveQuad(zLayer, c, x0, y0, x0 + 1.0f, y0, x0 + 1.0f, y0 + 1.0f, x0, y0 + 1.0f);
 }
 #pragma endregion
 
@@ -631,112 +2050,348 @@ void Engine::DrawPixel(int x, int y, Color c, float zLayer) {
 //=============================================================================
 #pragma region RG3GE::Engine::Texture - Functions
 Texture Engine::TextureLoad(const char* filename) {
+    Texture ret;
+    std::string key = _textureCacheKey(filename);
+    if (_textureCacheGet(key, ret)) {
+        // The file may have been passed to TextureLoadAsync before
+        if (TextureStatus(ret) != TextureLoadState::LOADING || TextureWait(ret) == TextureLoadState::READY) return ret;
+        TextureDestroy(ret);
+    }
+
+    if (_forwardToRenderThread([&] { ret = _textureLoad(filename, key); })) return ret;
+    return _textureLoad(filename, key);
+}
+
+Texture Engine::_textureLoad(const char* filename, const std::string& cacheKey) {
     Texture ret;
     ret.slot = -1;
 
-    int iSlot = nextFreeTextureSlot();
+    int iSlot = _texture_slots.allocate();
     if (iSlot == -1) {
         std::cout << "no free textures slots available: " << filename << std::endl;
         return ret;
     };
 
-    TextureSlot* slot = &_texture_slots[iSlot];
+    TextureSlot* slot = _texture_slots.get(iSlot);
 
-    unsigned char* databuffer = stbi_load(filename, &slot->width, &slot->height, &slot->colorchannels, 0);
+    // Always expand to RGBA, since that is what the texture (and the atlas pages) are made of
+    unsigned char* databuffer = stbi_load(filename, &slot->width, &slot->height, &slot->colorchannels, STBI_rgb_alpha);
 
     if (!databuffer) {
         std::cout << "failed to load texture: " << filename << std::endl;
+        _texture_slots.release(iSlot);
         return ret;
     }
 
-    GLCALL(glGenTextures(1, &slot->_gl_texture_id));
-    GLCALL(glBindTexture(GL_TEXTURE_2D, slot->_gl_texture_id));
-
-    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP));
-    GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP));
+    slot->opaque = true;
+    for (int i = 0; i < slot->width * slot->height; i++)
+        if (databuffer[i * 4 + 3] != 0xFF) {
+            slot->opaque = false;
+            break;
+        }
 
-    GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, slot->width, slot->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, databuffer));
-    GLCALL(glGenerateMipmap(GL_TEXTURE_2D));
+    if (!_atlasInsert(slot, databuffer)) {
+        GLCALL(glGenTextures(1, &slot->_gl_texture_id));
+        GLCALL(_gl.bindTexture(slot->_gl_texture_id));
+
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+        GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, slot->width, slot->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, databuffer));
+        GLCALL(glGenerateMipmap(GL_TEXTURE_2D));
+
+        slot->texture_plane = CreateShape2D(RG3GE::PolyShapes::QUADS, {{0.0f, 0.0f, 0.0f, 0.0f},
+                                                                       {(float)slot->width, 0.0f, 1.0f, 0.0f},
+                                                                       {(float)slot->width, (float)slot->height, 1.0f, 1.0f},
+                                                                       {0.0f, (float)slot->height, 0.0f, 1.0f}});
+        slot->atlasPage = -1;
+        slot->texX = 0;
+        slot->texY = 0;
+        slot->texWidth = slot->width;
+        slot->texHeight = slot->height;
+    }
 
     stbi_image_free(databuffer);
-    slot->texture_plane = CreateShape2D(RG3GE::PolyShapes::QUADS, {{0.0f, 0.0f, 0.0f, 0.0f},
-                                                                   {(float)slot->width, 1.0f, 1.0f, 0.0f},
-                                                                   {(float)slot->width, (float)slot->height, 1.0f, 1.0f},
-                                                                   {0.0f, (float)slot->height, 0.0f, 1.0f}});
     slot->users++;
+    _textureCachePut(cacheKey, iSlot, slot);
 
-    ret.cropSize.x = 1.0f;
-    ret.cropSize.y = 1.0f;
-    ret.uvOffset.x = 0;
-    ret.uvOffset.y = 0;
     ret.slot = iSlot;
+    ret.cropSize.x = 0;
+    ret.cropSize.y = 0;
+    TextureChangeCrop(ret, 0, 0, slot->width, slot->height);
 
     return ret;
 }
 
-void Engine::TextureChangeCrop(Texture& t, int x, int y, int w, int h) {
-    if (t.slot == -1) {
-        Debug("Warning!!! : texture has no slot assigned");
-        return;
+/**
+ * \return - true = the file is cached, ret is a new handle for it (counts as a hit, false counts as a miss)
+ */
+bool Engine::_textureCacheGet(const std::string& cacheKey, Texture& ret) {
+    int handle = -1;
+    TextureSlot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+        auto it = _texture_cache.find(cacheKey);
+        if (it != _texture_cache.end()) {
+            handle = it->second;
+            slot = _texture_slots.get(handle);
+        }
+
+        // Failed loads are never handed out, the file is read again
+        if (!slot || slot->state == TextureLoadState::FAILED) {
+            _texture_cache_misses++;
+            return false;
+        }
+        _texture_cache_hits++;
+        slot->cacheUsed = ++_texture_cache_clock;
+
+        // Counted right away (not deferred like in TextureClone), so a TextureWait, that drops the user
+        // of the cache on a failed load, can not free the slot underneath the new handle.
+        // The render thread only changes slots, while this thread waits for it.
+        slot->users++;
     }
 
-    TextureSlot* slot = &_texture_slots[t.slot];
-    if (slot->colorchannels <= 0) {
-        Debug("slot does not contain a texture");
-        return;
+    ret.slot = handle;
+    ret.cropSize.x = 0;
+    ret.cropSize.y = 0;
+    TextureChangeCrop(ret, 0, 0, slot->width, slot->height);
+    return true;
+}
+
+Texture Engine::TextureLoadAsync(const char* filename) {
+    Texture ret;
+    std::string key = _textureCacheKey(filename);
+    if (_textureCacheGet(key, ret)) return ret;  // may still be loading
+
+    ret.slot = -1;
+
+    // Only the header is read here, so the placeholder already has the size of the image
+    int width, height, channels;
+    if (!stbi_info(filename, &width, &height, &channels)) {
+        std::cout << "failed to load texture: " << filename << std::endl;
+        return ret;
+    }
+
+    auto create = [&] {
+        int iSlot = _texture_slots.allocate();
+        if (iSlot == -1) {
+            std::cout << "no free textures slots available: " << filename << std::endl;
+            return;
+        }
+
+        if (!_placeholder_texture) {
+            uint32_t color = ENGINE_TEXTURE_PLACEHOLDER_COLOR;
+            GLCALL(glGenTextures(1, &_placeholder_texture));
+            GLCALL(_gl.bindTexture(_placeholder_texture));
+            GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+            GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+            GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &color));
+        }
+
+        // Always a texture of its own, so the crop of the handle stays right, once the pixels arrive
+        TextureSlot* slot = _texture_slots.get(iSlot);
+        slot->width = slot->texWidth = width;
+        slot->height = slot->texHeight = height;
+        slot->colorchannels = channels;
+        slot->texX = 0;
+        slot->texY = 0;
+        slot->atlasPage = -1;
+        slot->opaque = false;
+        slot->state = TextureLoadState::LOADING;
+        slot->_gl_texture_id = _placeholder_texture;
+        slot->users = 1;
+        _textureCachePut(key, iSlot, slot);
+        slot->texture_plane = CreateShape2D(RG3GE::PolyShapes::QUADS, {{0.0f, 0.0f, 0.0f, 0.0f},
+                                                                       {(float)width, 0.0f, 1.0f, 0.0f},
+                                                                       {(float)width, (float)height, 1.0f, 1.0f},
+                                                                       {0.0f, (float)height, 0.0f, 1.0f}});
+
+        auto job = std::make_shared<TextureLoadJob>();
+        job->slot = iSlot;
+        job->filename = filename;
+        job->width = width;
+        job->height = height;
+        _texture_loads.push_back(job);
+
+        _texture_load_workers.submit([job] {
+            ProfileZone("TextureLoadAsync: decode");
+
+            int w, h, c;
+            unsigned char* pixels = stbi_load(job->filename.c_str(), &w, &h, &c, STBI_rgb_alpha);
+            if (pixels && (w != job->width || h != job->height)) {  // the file was changed in between
+                stbi_image_free(pixels);
+                pixels = nullptr;
+            }
+
+            bool opaque = pixels != nullptr;
+            for (int i = 0; opaque && i < w * h; i++)
+                opaque = pixels[i * 4 + 3] == 0xFF;
+
+            std::lock_guard<std::mutex> lock(_texture_loads_mutex);
+            job->pixels = pixels;
+            job->opaque = opaque;
+            job->decoded = true;
+            _texture_loads_cv.notify_all();
+        }, ENGINE_TEXTURE_LOAD_THREADS);
+
+        ret.slot = iSlot;
+    };
+    if (!_forwardToRenderThread(create)) create();
+
+    if (ret.slot == -1) return ret;
+
+    ret.cropSize.x = 0;
+    ret.cropSize.y = 0;
+    TextureChangeCrop(ret, 0, 0, width, height);
+
+    return ret;
+}
+
+TextureLoadState Engine::TextureStatus(const Texture& t) {
+    TextureSlot* slot = _texture_slots.get(t.slot);
+    return slot ? slot->state : TextureLoadState::FAILED;
+}
+
+TextureLoadState Engine::TextureWait(const Texture& t) {
+    TextureLoadState ret;
+    if (_forwardToRenderThread([&] { ret = TextureWait(t); })) return ret;
+
+    for (size_t i = 0; i < _texture_loads.size(); i++) {
+        auto job = _texture_loads[i];
+        if (job->slot != t.slot) continue;
+
+        {
+            ProfileZone("TextureWait");
+            std::unique_lock<std::mutex> lock(_texture_loads_mutex);
+            _texture_loads_cv.wait(lock, [&] { return job->decoded; });
+        }
+
+        size_t budget = SIZE_MAX;
+        _streamTexture(*job, budget);
+        _texture_loads.erase(_texture_loads.begin() + i);
+        break;
     }
 
-    t.cropSize.x = (float)w / slot->width;
-    t.cropSize.y = (float)h / slot->height;
-    t.uvOffset.x = (float)x / slot->width;
-    t.uvOffset.y = (float)y / slot->height;
+    return TextureStatus(t);
 }
 
-void Engine::TextureDraw(Texture& t, Transform& tr, float zLayer) {
-    if (t.slot == -1) {
-        Debug("Warning!!! : texture has no slot assigned");
-        return;
+/**
+ * Copies the next rows of a decoded texture through the pixel unpack buffer (at least one row, even if the budget is used up).
+ * \return - true = the job is done (the texture is READY or FAILED, or was destroyed in the meantime)
+ */
+bool Engine::_streamTexture(TextureLoadJob& job, size_t& budget) {
+    TextureSlot* slot = _texture_slots.get(job.slot);
+
+    if (!slot || !job.pixels) {
+        stbi_image_free(job.pixels);
+        job.pixels = nullptr;
+        if (job.texture) {
+            _gl.forgetTexture(job.texture);
+            GLCALL(glDeleteTextures(1, &job.texture));
+        }
+        if (!slot) return true;
+
+        std::cout << "failed to load texture: " << job.filename << std::endl;
+        slot->state = TextureLoadState::FAILED;
+
+        // The next load of the path has to read the file again
+        if (_textureCacheRemove(job.slot, slot)) freeTextureSlot(job.slot);
+        return true;
+    }
+
+    if (!job.texture) {
+        GLCALL(glGenTextures(1, &job.texture));
+        GLCALL(_gl.bindTexture(job.texture));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, job.width, job.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
     }
+    if (!_texture_upload_buffer) GLCALL(glGenBuffers(1, &_texture_upload_buffer));
+
+    size_t rowBytes = (size_t)job.width * 4;
+    int rows = std::min(job.height - job.rowsDone, std::max(1, (int)std::min(budget / rowBytes, (size_t)job.height)));
+    size_t bytes = rowBytes * rows;
+
+    // glBufferData hands the buffer of the previous upload back to the driver, so this never waits for the GPU.
+    // The copy into the texture happens, whenever the GPU gets to it.
+    GLCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _texture_upload_buffer));
+    GLCALL(glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, job.pixels + rowBytes * job.rowsDone, GL_STREAM_DRAW));
+    GLCALL(_gl.bindTexture(job.texture));
+    GLCALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.rowsDone, job.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GLCALL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+    job.rowsDone += rows;
+    budget -= std::min(budget, bytes);
+    if (job.rowsDone < job.height) return false;
+
+    // No mipmaps: the textures are only sampled with GL_NEAREST
+    slot->_gl_texture_id = job.texture;
+    slot->opaque = job.opaque;
+    slot->state = TextureLoadState::READY;
+
+    stbi_image_free(job.pixels);
+    job.pixels = nullptr;
+    job.texture = 0;
+    return true;
+}
 
-    glUniform1i(shader.u_shader_mode, 1);
+void Engine::_streamTextures() {
+    if (_texture_loads.empty()) return;
+    if (_deferToRenderThread([this] { _streamTextures(); })) return;  // the slots may only change between two frames
 
-    glEnableVertexAttribArray(shader.a_position);
-    glEnableVertexAttribArray(shader.a_color);
-    glEnableVertexAttribArray(shader.a_uvCoords);
-    glEnableClientState(GL_VERTEX_ARRAY);
+    ProfileZone("RenderAll: texture uploads");
+    size_t budget = ENGINE_TEXTURE_UPLOAD_BYTES;
 
-    glPushMatrix();
+    for (size_t i = 0; i < _texture_loads.size() && budget > 0;) {
+        TextureLoadJob& job = *_texture_loads[i];
 
-    _applyTransform(tr, zLayer);
-    glUniform4f(
-        shader.u_textureCrop,
-        t.cropSize.x,
-        t.cropSize.y,
-        t.uvOffset.x,
-        t.uvOffset.y);
+        bool decoded;
+        {
+            std::lock_guard<std::mutex> lock(_texture_loads_mutex);
+            decoded = job.decoded;
+        }
 
-    glBindBuffer(GL_ARRAY_BUFFER, _texture_slots[t.slot].texture_plane.vertexBuffer);
-    glVertexPointer(2, GL_FLOAT, 0, NULL);
-    glVertexAttribPointer(shader.a_position, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), 0);
-    glVertexAttribPointer(shader.a_color, 4, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), (void*)(2 * sizeof(GL_FLOAT)));
-    glVertexAttribPointer(shader.a_uvCoords, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex2D), (void*)(6 * sizeof(GL_FLOAT)));
+        if (decoded && _streamTexture(job, budget))
+            _texture_loads.erase(_texture_loads.begin() + i);
+        else
+            i++;
+    }
+}
 
-    glActiveTexture(GL_TEXTURE0);
+void Engine::TextureChangeCrop(Texture& t, int x, int y, int w, int h) {
+    TextureSlot* slot = _texture_slots.get(t.slot);
+    if (!slot) {
+        Debug("Warning!!! : texture has no slot assigned");
+        return;
+    }
 
-    glBindTexture(GL_TEXTURE_2D, _texture_slots[t.slot]._gl_texture_id);
-    glUniform1i(shader.u_texture, 0);
-    glDrawArrays(static_cast<GLint>(_texture_slots[t.slot].texture_plane.shape), 0, _texture_slots[t.slot].texture_plane.vertexCnt);
+    // Crop and offset are relative to the whole OpenGL texture (which may be an atlas page)
+    t.cropSize.x = (float)w / slot->texWidth;
+    t.cropSize.y = (float)h / slot->texHeight;
+    t.uvOffset.x = (float)(slot->texX + x) / slot->texWidth;
+    t.uvOffset.y = (float)(slot->texY + y) / slot->texHeight;
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+void Engine::TextureDraw(int entry, int count) {
+    uint32_t job = _render_order[entry];
+    RenderQueue::TextureRef& t = _render_queue.textures[_render_queue.subject[job]];
+    TextureSlot* slot = _texture_slots.get(t.slot);
+    if (!slot) {
+        Debug("Warning!!! : texture has no slot assigned");
+        return;
+    }
 
-    glPopMatrix();
+    _gl.uniform1i(shader.u_shader_mode, 1);
+    _gl.uniform1i(shader.u_job, entry);
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableVertexAttribArray(shader.a_position);
-    glDisableVertexAttribArray(shader.a_color);
-    glDisableVertexAttribArray(shader.a_uvCoords);
+    // Textures on the same atlas page also share the plane
+    _gl.bindVertexArray(slot->texture_plane.vertexArray);
+    _gl.bindTexture(slot->_gl_texture_id);
+    _drawShapeGeometry(slot->texture_plane, count);
 }
 
 Texture Engine::TextureClone(Texture& src) {
@@ -746,11 +2401,283 @@ Texture Engine::TextureClone(Texture& src) {
     ret.cropSize = src.cropSize;
     ret.uvOffset = src.uvOffset;
 
+    // Clones share the slot, so the texture is only freed, once all of them are destroyed
+    int handle = src.slot;
+    auto addUser = [handle] {
+        TextureSlot* slot = _texture_slots.get(handle);
+        if (slot) slot->users++;
+    };
+    if (!_deferToRenderThread(addUser)) addUser();
+
     return ret;
 }
 
 void Engine::TextureDestroy(Texture& t) {
-    if (t.slot != -1) freeTextureSlot(t.slot);
+    int handle = t.slot;
+    t.slot = -1;
+    if (handle == -1) return;
+
+    if (!_deferToRenderThread([this, handle] { freeTextureSlot(handle); })) freeTextureSlot(handle);
+}
+
+void Engine::TextureCacheEvictUnused() {
+    std::vector<int> handles;
+    {
+        // The cache is the only user left
+        std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+        for (auto it = _texture_cache.begin(); it != _texture_cache.end();) {
+            TextureSlot* slot = _texture_slots.get(it->second);
+            if (slot && slot->users > 1) {
+                it++;
+                continue;
+            }
+            handles.push_back(it->second);
+            it = _texture_cache.erase(it);
+        }
+    }
+
+    for (int handle : handles)
+        if (!_deferToRenderThread([this, handle] { freeTextureSlot(handle); })) freeTextureSlot(handle);
+}
+
+void Engine::TextureCacheEvict(const char* filename) {
+    int handle = -1;
+    {
+        std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+        auto it = _texture_cache.find(_textureCacheKey(filename));
+        if (it == _texture_cache.end()) return;
+        handle = it->second;
+        _texture_cache.erase(it);
+    }
+
+    // Drops the user, that the cache was
+    if (!_deferToRenderThread([this, handle] { freeTextureSlot(handle); })) freeTextureSlot(handle);
+}
+
+/** Evicts unused textures (least recently loaded first), until the rest of them fits into ENGINE_TEXTURE_CACHE_BYTES */
+void Engine::_textureCacheTrim() {
+    std::vector<std::pair<uint64_t, int>> unused;  // last use, handle
+    size_t bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+        for (auto& it : _texture_cache) {
+            TextureSlot* slot = _texture_slots.get(it.second);
+            if (!slot || slot->users > 1) continue;
+            unused.push_back({slot->cacheUsed, it.second});
+            bytes += _textureBytes(slot);
+        }
+    }
+    if (bytes <= (size_t)ENGINE_TEXTURE_CACHE_BYTES) return;
+
+    std::sort(unused.begin(), unused.end());
+    for (auto& [used, handle] : unused) {
+        if (bytes <= (size_t)ENGINE_TEXTURE_CACHE_BYTES) break;
+
+        TextureSlot* slot = _texture_slots.get(handle);
+        bytes -= _textureBytes(slot);
+        if (_textureCacheRemove(handle, slot)) freeTextureSlot(handle);
+    }
+}
+
+TextureCacheStats Engine::textureCacheStats() {
+    TextureCacheStats ret;
+
+    std::lock_guard<std::mutex> lock(_texture_cache_mutex);
+    ret.hits = _texture_cache_hits;
+    ret.misses = _texture_cache_misses;
+    for (auto& it : _texture_cache) {
+        TextureSlot* slot = _texture_slots.get(it.second);
+        if (!slot) continue;
+        ret.textures++;
+        if (slot->users <= 1) ret.unused++;
+        ret.bytes += _textureBytes(slot);
+    }
+
+    return ret;
+}
+#pragma endregion
+
+//=============================================================================
+// RG3GE::Engine::Canvas - Functions
+//   The pixels are only touched by the game side. RenderAll() copies the
+//   changed area of every canvas into its texture (on the render thread,
+//   the area is copied out first and uploaded before the frame is drawn).
+//-----------------------------------------------------------------------------
+//=============================================================================
+#pragma region RG3GE::Engine::Canvas - Functions
+struct CanvasSlot {
+    RG3GE::Core::PixelCanvas pixels;
+    int texture = -1;  // TextureSlot handle
+    bool queued = false;  // true = is in _dirty_canvases
+};
+static RG3GE::Core::HandlePool<CanvasSlot> _canvas_slots;
+static std::vector<int> _dirty_canvases;
+
+static CanvasSlot* _dirtyCanvas(Canvas& canvas) {
+    CanvasSlot* c = _canvas_slots.get(canvas.id);
+    if (!c) {
+        Debug("Warning!!! : canvas was not created via CanvasCreate or is already destroyed");
+        return nullptr;
+    }
+
+    if (!c->queued) {
+        c->queued = true;
+        _dirty_canvases.push_back(canvas.id);
+    }
+    return c;
+}
+
+/** \param rowLength - pixels from one row of src to the next */
+static void _uploadCanvasRect(int texture, int x, int y, int w, int h, const uint32_t* src, int rowLength) {
+    TextureSlot* slot = _texture_slots.get(texture);
+    if (!slot) return;
+
+    GLCALL(_gl.bindTexture(slot->_gl_texture_id));
+    GLCALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength));
+    GLCALL(glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, src));
+    GLCALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+}
+
+Canvas Engine::CanvasCreate(int width, int height, Color clear) {
+    Canvas ret;
+    ret.width = 0;
+    ret.height = 0;
+    ret.texture.slot = -1;
+    ret.id = -1;
+
+    if (width <= 0 || height <= 0) {
+        std::cout << "canvas size has to be greater than 0" << std::endl;
+        return ret;
+    }
+
+    ret.id = _canvas_slots.allocate();
+    if (ret.id == -1) {
+        std::cout << "no free canvas slots available" << std::endl;
+        return ret;
+    }
+
+    CanvasSlot* c = _canvas_slots.get(ret.id);
+    c->pixels.resize(width, height);
+    c->pixels.fill(0, 0, width, height, RG3GE::Core::PackRGBA8(clear));
+
+    // The first upload happens with glTexImage2D
+    int dx, dy, dw, dh;
+    c->pixels.takeDirty(dx, dy, dw, dh);
+
+    const uint32_t* pixels = c->pixels.data();
+    auto create = [&] {
+        int iSlot = _texture_slots.allocate();
+        if (iSlot == -1) return;
+
+        TextureSlot* slot = _texture_slots.get(iSlot);
+        slot->width = slot->texWidth = width;
+        slot->height = slot->texHeight = height;
+        slot->colorchannels = 4;
+        slot->opaque = false;  // the pixels can change at any time
+        slot->atlasPage = -1;
+        slot->users = 1;
+
+        GLCALL(glGenTextures(1, &slot->_gl_texture_id));
+        GLCALL(_gl.bindTexture(slot->_gl_texture_id));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+
+        slot->texture_plane = CreateShape2D(RG3GE::PolyShapes::QUADS, {{0.0f, 0.0f, 0.0f, 0.0f},
+                                                                       {(float)width, 0.0f, 1.0f, 0.0f},
+                                                                       {(float)width, (float)height, 1.0f, 1.0f},
+                                                                       {0.0f, (float)height, 0.0f, 1.0f}});
+        ret.texture.slot = iSlot;
+    };
+    if (!_forwardToRenderThread(create)) create();
+
+    if (ret.texture.slot == -1) {
+        std::cout << "no free textures slots available for the canvas" << std::endl;
+        _canvas_slots.release(ret.id);
+        ret.id = -1;
+        return ret;
+    }
+
+    c->texture = ret.texture.slot;
+    ret.width = width;
+    ret.height = height;
+    ret.texture.cropSize.x = 0;
+    ret.texture.cropSize.y = 0;
+    TextureChangeCrop(ret.texture, 0, 0, width, height);
+
+    return ret;
+}
+
+void Engine::CanvasDestroy(Canvas& canvas) {
+    CanvasSlot* c = _canvas_slots.get(canvas.id);
+    if (!c) {
+        Debug("Warning!!! : canvas was not created via CanvasCreate or is already destroyed");
+        return;
+    }
+
+    Texture t = canvas.texture;
+    t.slot = c->texture;
+    TextureDestroy(t);
+
+    _canvas_slots.release(canvas.id);
+    canvas.id = -1;
+    canvas.texture.slot = -1;
+}
+
+void Engine::CanvasSetPixel(Canvas& canvas, int x, int y, Color c) {
+    CanvasSlot* slot = _dirtyCanvas(canvas);
+    if (slot) slot->pixels.setPixel(x, y, RG3GE::Core::PackRGBA8(c));
+}
+
+void Engine::CanvasFill(Canvas& canvas, int x, int y, int w, int h, Color c) {
+    CanvasSlot* slot = _dirtyCanvas(canvas);
+    if (slot) slot->pixels.fill(x, y, w, h, RG3GE::Core::PackRGBA8(c));
+}
+
+void Engine::CanvasClear(Canvas& canvas, Color c) {
+    CanvasSlot* slot = _dirtyCanvas(canvas);
+    if (slot) slot->pixels.fill(0, 0, slot->pixels.width(), slot->pixels.height(), RG3GE::Core::PackRGBA8(c));
+}
+
+void Engine::CanvasBlit(Canvas& canvas, int x, int y, int w, int h, const unsigned char* rgba, int pitch) {
+    CanvasSlot* slot = _dirtyCanvas(canvas);
+    if (!slot) return;
+
+    // The bytes are already in the order of the packed pixels (r in the lowest byte)
+    slot->pixels.blit(x, y, w, h, (const uint32_t*)rgba, pitch > 0 ? pitch / 4 : w);
+}
+
+void Engine::_uploadCanvases() {
+    if (_dirty_canvases.empty()) return;
+    ProfileZone("RenderAll: canvas uploads");
+
+    for (int id : _dirty_canvases) {
+        CanvasSlot* c = _canvas_slots.get(id);
+        if (!c) continue;
+        c->queued = false;
+
+        int x, y, w, h;
+        if (!c->pixels.takeDirty(x, y, w, h)) continue;
+
+        int width = c->pixels.width();
+        const uint32_t* src = c->pixels.data() + (size_t)y * width + x;
+
+        if (_needsRenderThread()) {
+            // The canvas can be changed again, before the render thread gets to it
+            std::vector<uint32_t> area((size_t)w * h);
+            for (int row = 0; row < h; row++)
+                std::copy(src + (size_t)row * width, src + (size_t)row * width + w, area.begin() + (size_t)row * w);
+
+            int texture = c->texture;
+            _deferToRenderThread([texture, x, y, w, h, area] { _uploadCanvasRect(texture, x, y, w, h, area.data(), w); });
+        } else {
+            _uploadCanvasRect(c->texture, x, y, w, h, src, width);
+        }
+    }
+
+    _dirty_canvases.clear();
 }
 #pragma endregion
 
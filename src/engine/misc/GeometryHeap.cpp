@@ -0,0 +1,58 @@
+#include "./GeometryHeap.h"
+
+namespace RG3GE::Core {
+
+    GeometryHeap::GeometryHeap(int capacity) { reset(capacity); }
+
+    void GeometryHeap::reset(int capacity) {
+        _capacity = capacity;
+        _used = 0;
+        _free.clear();
+        if (capacity > 0) _free.push_back({0, capacity});
+    }
+
+    int GeometryHeap::allocate(int count) {
+        if (count <= 0) return -1;
+
+        for (size_t i = 0; i < _free.size(); i++) {
+            Range& r = _free[i];
+            if (r.count < count) continue;
+
+            int first = r.first;
+            r.first += count;
+            r.count -= count;
+            if (r.count == 0) _free.erase(_free.begin() + i);
+
+            _used += count;
+            return first;
+        }
+
+        return -1;
+    }
+
+    void GeometryHeap::free(int first, int count) {
+        if (count <= 0 || first < 0 || first + count > _capacity) return;
+
+        // First free range behind the one, that is given back
+        size_t i = 0;
+        while (i < _free.size() && _free[i].first < first) i++;
+
+        bool mergePrev = i > 0 && _free[i - 1].first + _free[i - 1].count == first;
+        bool mergeNext = i < _free.size() && first + count == _free[i].first;
+
+        if (mergePrev && mergeNext) {
+            _free[i - 1].count += count + _free[i].count;
+            _free.erase(_free.begin() + i);
+        } else if (mergePrev) {
+            _free[i - 1].count += count;
+        } else if (mergeNext) {
+            _free[i].first = first;
+            _free[i].count += count;
+        } else {
+            _free.insert(_free.begin() + i, {first, count});
+        }
+
+        _used -= count;
+    }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * Offset allocator for one large vertex buffer (first fit, measured in vertices).
+     * Free ranges are kept sorted by their offset and merged with their neighbours,
+     * so the buffer does not fragment into pieces, that are too small to be reused.
+     */
+    class GeometryHeap {
+    public:
+        GeometryHeap(int capacity = 0);
+
+        /** Forgets all allocations */
+        void reset(int capacity);
+
+        /** \return - the first vertex of a free range with room for count vertices, or -1 if there is none */
+        int allocate(int count);
+
+        /** Gives a range back, that was returned by allocate (with the same count) */
+        void free(int first, int count);
+
+        int capacity() const { return _capacity; }
+        int used() const { return _used; }
+
+    private:
+        struct Range {
+            int first, count;
+        };
+
+        int _capacity = 0;
+        int _used = 0;
+        std::vector<Range> _free;
+    };
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * Growable pool, whose entries are addressed via handles.
+     *
+     * A handle packs the index of the entry (lower INDEX_BITS) and the generation
+     * of the entry at the time it was allocated. Each release bumps the generation,
+     * so handles to freed (or since reused) entries are detected by get().
+     * Freed entries are reused via a free list, so allocate() and release() are O(1).
+     */
+    template <typename T>
+    class HandlePool {
+    public:
+        static const int INDEX_BITS = 20;
+        static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static const uint32_t GENERATION_MAX = (1u << (31 - INDEX_BITS)) - 1;
+
+        void reserve(size_t n) {
+            entries.reserve(n);
+            freeList.reserve(n);
+        }
+
+        /** \return - the handle of a fresh (default constructed) entry, or -1 if the pool is full */
+        int allocate() {
+            uint32_t index;
+            if (!freeList.empty()) {
+                index = freeList.back();
+                freeList.pop_back();
+            } else {
+                if (entries.size() > INDEX_MASK) return -1;
+                index = (uint32_t)entries.size();
+                entries.emplace_back();
+            }
+
+            Entry& e = entries[index];
+            e.value = T();
+            e.alive = true;
+            live++;
+
+            return (int)((e.generation << INDEX_BITS) | index);
+        }
+
+        /** Frees the entry. Stale or invalid handles are ignored */
+        void release(int handle) {
+            Entry* e = entry(handle);
+            if (!e) return;
+
+            e->alive = false;
+            e->generation = (e->generation % GENERATION_MAX) + 1;
+            freeList.push_back((uint32_t)handle & INDEX_MASK);
+            live--;
+        }
+
+        /**
+         * \return - the entry behind the handle or nullptr, if the handle is invalid or stale
+         *           (the pointer is only valid until the next allocate())
+         */
+        T* get(int handle) {
+            Entry* e = entry(handle);
+            return e ? &e->value : nullptr;
+        }
+
+        /** \return - the number of allocated entries */
+        size_t size() const { return live; }
+
+        /** Calls f(handle, T&) for every allocated entry */
+        template <typename F>
+        void forEach(F f) {
+            for (size_t i = 0; i < entries.size(); i++) {
+                Entry& e = entries[i];
+                if (e.alive) f((int)((e.generation << INDEX_BITS) | (uint32_t)i), e.value);
+            }
+        }
+
+    private:
+        struct Entry {
+            T value;
+            uint32_t generation = 1;
+            bool alive = false;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<uint32_t> freeList;
+        size_t live = 0;
+
+        Entry* entry(int handle) {
+            if (handle < 0) return nullptr;
+
+            uint32_t index = (uint32_t)handle & INDEX_MASK;
+            if (index >= entries.size()) return nullptr;
+
+            Entry& e = entries[index];
+            if (!e.alive || e.generation != ((uint32_t)handle >> INDEX_BITS)) return nullptr;
+
+            return &e;
+        }
+    };
+
+}
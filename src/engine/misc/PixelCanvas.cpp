@@ -0,0 +1,101 @@
+#include "./PixelCanvas.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXELCANVAS_SSE2
+#endif
+
+namespace RG3GE::Core {
+
+    void PixelCanvas::resize(int width, int height) {
+        _width = std::max(width, 0);
+        _height = std::max(height, 0);
+        _pixels.assign((size_t)_width * _height, 0);
+        markDirty(0, 0, _width, _height);
+    }
+
+    bool PixelCanvas::clip(int& x, int& y, int& w, int& h) const {
+        if (x < 0) { w += x; x = 0; }
+        if (y < 0) { h += y; y = 0; }
+        w = std::min(w, _width - x);
+        h = std::min(h, _height - y);
+        return w > 0 && h > 0;
+    }
+
+    void PixelCanvas::fill(int x, int y, int w, int h, uint32_t rgba) {
+        if (!clip(x, y, w, h)) return;
+
+        for (int row = y; row < y + h; row++) {
+            uint32_t* p = &_pixels[(size_t)row * _width + x];
+            int i = 0;
+
+#ifdef PIXELCANVAS_SSE2
+            // 4 pixels per store (16 per loop)
+            __m128i v = _mm_set1_epi32((int)rgba);
+            for (; i + 16 <= w; i += 16) {
+                _mm_storeu_si128((__m128i*)(p + i + 0), v);
+                _mm_storeu_si128((__m128i*)(p + i + 4), v);
+                _mm_storeu_si128((__m128i*)(p + i + 8), v);
+                _mm_storeu_si128((__m128i*)(p + i + 12), v);
+            }
+            for (; i + 4 <= w; i += 4)
+                _mm_storeu_si128((__m128i*)(p + i), v);
+#endif
+
+            for (; i < w; i++) p[i] = rgba;
+        }
+
+        markDirty(x, y, w, h);
+    }
+
+    void PixelCanvas::blit(int x, int y, int w, int h, const uint32_t* src, int pitch) {
+        int dx = x, dy = y;
+        if (!src || !clip(dx, dy, w, h)) return;
+
+        // Skip the part of src, that was clipped away
+        src += (size_t)(dy - y) * pitch + (dx - x);
+
+        // Rows are copied as a whole (memcpy already moves them with the widest stores the CPU has)
+        if (dx == 0 && w == _width && pitch == _width) {
+            std::memcpy(&_pixels[(size_t)dy * _width], src, (size_t)w * h * sizeof(uint32_t));
+        } else {
+            for (int row = 0; row < h; row++)
+                std::memcpy(&_pixels[(size_t)(dy + row) * _width + dx], src + (size_t)row * pitch, (size_t)w * sizeof(uint32_t));
+        }
+
+        markDirty(dx, dy, w, h);
+    }
+
+    void PixelCanvas::markDirty(int x, int y, int w, int h) {
+        if (w <= 0 || h <= 0) return;
+
+        if (!dirty()) {
+            _dirtyMinX = x;
+            _dirtyMinY = y;
+            _dirtyMaxX = x + w;
+            _dirtyMaxY = y + h;
+            return;
+        }
+
+        _dirtyMinX = std::min(_dirtyMinX, x);
+        _dirtyMinY = std::min(_dirtyMinY, y);
+        _dirtyMaxX = std::max(_dirtyMaxX, x + w);
+        _dirtyMaxY = std::max(_dirtyMaxY, y + h);
+    }
+
+    bool PixelCanvas::takeDirty(int& x, int& y, int& w, int& h) {
+        if (!dirty()) return false;
+
+        x = _dirtyMinX;
+        y = _dirtyMinY;
+        w = _dirtyMaxX - _dirtyMinX;
+        h = _dirtyMaxY - _dirtyMinY;
+
+        _dirtyMinX = _dirtyMinY = _dirtyMaxX = _dirtyMaxY = 0;
+        return true;
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * RGBA8 pixels in RAM (one uint32_t per pixel, r in the lowest byte, rows top to bottom).
+     * Remembers the bounding box of everything that changed since the last takeDirty(),
+     * so only that part has to be copied to the texture.
+     * All functions clip against the canvas.
+     */
+    class PixelCanvas {
+    public:
+        void resize(int width, int height);
+
+        void setPixel(int x, int y, uint32_t rgba) {
+            if ((unsigned int)x >= (unsigned int)_width || (unsigned int)y >= (unsigned int)_height) return;
+            _pixels[(size_t)y * _width + x] = rgba;
+            markDirty(x, y, 1, 1);
+        }
+
+        void fill(int x, int y, int w, int h, uint32_t rgba);
+
+        /** Copies w * h pixels from src (pitch = pixels from one row of src to the next) */
+        void blit(int x, int y, int w, int h, const uint32_t* src, int pitch);
+
+        void markDirty(int x, int y, int w, int h);
+
+        /**
+         * Hands out the changed area and forgets it.
+         * \return - false if nothing has changed
+         */
+        bool takeDirty(int& x, int& y, int& w, int& h);
+
+        bool dirty() const { return _dirtyMaxX > _dirtyMinX; }
+
+        int width() const { return _width; }
+        int height() const { return _height; }
+        const uint32_t* data() const { return _pixels.data(); }
+
+    private:
+        int _width = 0, _height = 0;
+        std::vector<uint32_t> _pixels;
+
+        // Empty, if max <= min
+        int _dirtyMinX = 0, _dirtyMinY = 0;
+        int _dirtyMaxX = 0, _dirtyMaxY = 0;
+
+        /** Cuts the rectangle down to the canvas. \return - false if nothing is left */
+        bool clip(int& x, int& y, int& w, int& h) const;
+    };
+
+}
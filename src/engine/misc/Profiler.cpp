@@ -0,0 +1,119 @@
+#include "../Profiler.h"
+
+#ifdef RG3GE_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace RG3GE::Profiler {
+
+    struct ZoneEvent {
+        const char* name;
+        int64_t start;     // in microseconds
+        int64_t duration;  // in microseconds
+    };
+
+    /**
+     * Only the owning thread writes into its ring, so recording needs no lock.
+     * The write position is published with release semantics, so the dump sees complete events.
+     * (events, that get overwritten during a dump, may show up with mixed values)
+     */
+    struct ThreadRing {
+        ZoneEvent events[ENGINE_PROFILE_EVENTS];
+        std::atomic<uint64_t> written{0};
+        int id = 0;
+        const char* name = nullptr;
+    };
+
+    static std::vector<std::unique_ptr<ThreadRing>> _rings;
+    static std::mutex _rings_mutex;
+    static thread_local ThreadRing* _ring = nullptr;
+
+    static int64_t _now() {
+        using namespace std::chrono;
+        static const steady_clock::time_point start = steady_clock::now();
+        return duration_cast<microseconds>(steady_clock::now() - start).count();
+    }
+
+    /** Rings are never freed, so zones of threads, that have already ended, still show up in the dump */
+    static ThreadRing* _threadRing() {
+        if (_ring) return _ring;
+
+        std::lock_guard<std::mutex> lock(_rings_mutex);
+        _rings.push_back(std::make_unique<ThreadRing>());
+        _ring = _rings.back().get();
+        _ring->id = (int)_rings.size();
+        return _ring;
+    }
+
+    Zone::Zone(const char* name)
+        : name(name), start(_now()) {}
+
+    Zone::~Zone() {
+        ThreadRing* r = _threadRing();
+
+        uint64_t w = r->written.load(std::memory_order_relaxed);
+        r->events[w % ENGINE_PROFILE_EVENTS] = {name, start, _now() - start};
+        r->written.store(w + 1, std::memory_order_release);
+    }
+
+    void SetThreadName(const char* name) {
+        ThreadRing* r = _threadRing();
+
+        std::lock_guard<std::mutex> lock(_rings_mutex);
+        r->name = name;
+    }
+
+    static void _writeString(FILE* f, const char* s) {
+        fputc('"', f);
+        for (; *s; s++) {
+            if (*s == '"' || *s == '\\')
+                fputc('\\', f);
+            if ((unsigned char)*s < 0x20)
+                continue;
+            fputc(*s, f);
+        }
+        fputc('"', f);
+    }
+
+    bool DumpChromeTrace(const char* filename) {
+        FILE* f = fopen(filename, "w");
+        if (!f) return false;
+
+        fputs("{\"traceEvents\":[\n", f);
+        bool first = true;
+
+        std::lock_guard<std::mutex> lock(_rings_mutex);
+        for (auto& r : _rings) {
+            if (r->name) {
+                fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", r->id);
+                _writeString(f, r->name);
+                fputs("}}", f);
+                first = false;
+            }
+
+            uint64_t written = r->written.load(std::memory_order_acquire);
+            uint64_t begin = written > ENGINE_PROFILE_EVENTS ? written - ENGINE_PROFILE_EVENTS : 0;
+
+            for (uint64_t i = begin; i < written; i++) {
+                ZoneEvent e = r->events[i % ENGINE_PROFILE_EVENTS];
+
+                fprintf(f, "%s{\"name\":", first ? "" : ",\n");
+                _writeString(f, e.name);
+                fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+                        r->id, (long long)e.start, (long long)e.duration);
+                first = false;
+            }
+        }
+
+        fputs("\n]}\n", f);
+        return fclose(f) == 0;
+    }
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "./RadixSort.h"
+
+namespace RG3GE::Core {
+
+    void RadixSortIndices(const uint64_t* keys, size_t count, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch) {
+        order.resize(count);
+        for (size_t i = 0; i < count; i++)
+            order[i] = (uint32_t)i;
+
+        RadixSortIndices(keys, order, scratch);
+    }
+
+    void RadixSortIndices(const uint64_t* keys, std::vector<uint32_t>& order, std::vector<uint32_t>& scratch) {
+        size_t count = order.size();
+        scratch.resize(count);
+
+        if (count < 2) return;
+
+        // Build the histograms of all 8 digits in one go
+        uint32_t histogram[8][256] = {};
+        for (size_t i = 0; i < count; i++) {
+            uint64_t k = keys[order[i]];
+            for (int d = 0; d < 8; d++)
+                histogram[d][(k >> (d * 8)) & 0xFF]++;
+        }
+
+        uint32_t* src = order.data();
+        uint32_t* dst = scratch.data();
+
+        for (int d = 0; d < 8; d++) {
+            uint32_t* h = histogram[d];
+
+            // All keys share this digit => the pass would not change anything
+            if (h[(keys[src[0]] >> (d * 8)) & 0xFF] == count) continue;
+
+            uint32_t sum = 0;
+            for (int b = 0; b < 256; b++) {
+                uint32_t c = h[b];
+                h[b] = sum;
+                sum += c;
+            }
+
+            int shift = d * 8;
+            for (size_t i = 0; i < count; i++) {
+                uint32_t idx = src[i];
+                dst[h[(keys[idx] >> shift) & 0xFF]++] = idx;
+            }
+
+            uint32_t* t = src;
+            src = dst;
+            dst = t;
+        }
+
+        if (src != order.data())
+            order.swap(scratch);
+    }
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * Stable LSD radix sort over an index array.
+     * Fills `order` with the indices of `keys` in ascending key order. Jobs with the
+     * same key keep the order they were submitted in.
+     *
+     * \param keys - the keys to sort by (they are not moved)
+     * \param count - number of keys
+     * \param order - receives the sorted indices
+     * \param scratch - temporary storage (kept by the caller to avoid reallocations)
+     */
+    void RadixSortIndices(
+            const uint64_t* keys, size_t count,
+            std::vector<uint32_t>& order,
+            std::vector<uint32_t>& scratch
+    );
+
+    /**
+     * Same as above, but only sorts the indices, that are already in `order`
+     * (used to sort a subset of the keys, for example after culling).
+     */
+    void RadixSortIndices(
+            const uint64_t* keys,
+            std::vector<uint32_t>& order,
+            std::vector<uint32_t>& scratch
+    );
+
+}
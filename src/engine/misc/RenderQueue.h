@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "../Engine.h"
+#include "../Transform.h"
+#include "../TransformArray.h"
+
+namespace RG3GE::Core {
+
+    /** \return - the color as RGBA8 (r in the lowest byte, so it can be fed to OpenGL as 4 normalized unsigned bytes) */
+    inline uint32_t PackRGBA8(const Color& c) {
+        auto ch = [](float v) -> uint32_t {
+            v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+            return (uint32_t)(v * 255.0f + 0.5f);
+        };
+        return ch(c.r) | ch(c.g) << 8 | ch(c.b) << 16 | ch(c.a) << 24;
+    }
+
+    inline Color UnpackRGBA8(uint32_t rgba) {
+        return Color((int)(rgba & 0xFF), (int)((rgba >> 8) & 0xFF), (int)((rgba >> 16) & 0xFF), (int)(rgba >> 24));
+    }
+
+    /**
+     * Everything that was submitted for rendering during one frame, stored as structure of arrays.
+     * The arrays are indexed by the job number returned from push(). Jobs are never moved,
+     * the renderer only sorts an index array.
+     */
+    struct RenderQueue {
+        enum : uint8_t { SHAPE = 0, TEXTURE = 1, PRIMITIVES = 2 };
+
+        /** Texture jobs reference the slot and the crop of the Texture handle they were submitted with */
+        struct TextureRef {
+            int slot;
+            float cropW, cropH;
+            float u, v;
+        };
+
+        /** Triangles of DrawPixel / DrawLine / DrawRectFilled, that share a zLayer (drawn as one job) */
+        struct PrimitiveLayer {
+            float z = 0.0f;
+            bool opaque = true;
+            std::vector<PackedVertex2D> vertices;
+        };
+
+        // Transform (rotation is stored as cos/sin)
+        std::vector<float> x, y;
+        std::vector<float> originX, originY;
+        std::vector<float> scaleX, scaleY;
+        std::vector<float> cos, sin;
+        std::vector<float> z;
+
+        std::vector<uint32_t> tint;    // RGBA8
+        std::vector<uint32_t> subject; // shape id (SHAPE) or index into textures (TEXTURE)
+        std::vector<uint8_t> type;
+        std::vector<uint64_t> key;     // render order
+
+        std::vector<TextureRef> textures;
+
+        // Only the first primitiveLayers are in use, the others keep their memory for the next frames
+        std::vector<PrimitiveLayer> primitives;
+        size_t primitiveLayers = 0;
+        size_t lastPrimitiveLayer = 0;
+
+        size_t size() const { return type.size(); }
+
+        void reserve(size_t n) {
+            for (auto v : {&x, &y, &originX, &originY, &scaleX, &scaleY, &cos, &sin, &z}) v->reserve(n);
+            tint.reserve(n);
+            subject.reserve(n);
+            type.reserve(n);
+            key.reserve(n);
+            textures.reserve(n);
+        }
+
+        void clear() {
+            for (auto v : {&x, &y, &originX, &originY, &scaleX, &scaleY, &cos, &sin, &z}) v->clear();
+            tint.clear();
+            subject.clear();
+            type.clear();
+            key.clear();
+            textures.clear();
+
+            for (size_t i = 0; i < primitiveLayers; i++) primitives[i].vertices.clear();
+            primitiveLayers = 0;
+        }
+
+        /** \return - the number of the new job */
+        uint32_t push(uint8_t jobType, uint32_t jobSubject, const Transform& tr, float zLayer, uint32_t rgba, uint64_t jobKey) {
+            x.push_back(tr.position.x);
+            y.push_back(tr.position.y);
+            originX.push_back(tr.origin.x);
+            originY.push_back(tr.origin.y);
+            scaleX.push_back(tr.scale.x);
+            scaleY.push_back(tr.scale.y);
+            cos.push_back((float)tr.rotation.direction.x);
+            sin.push_back((float)tr.rotation.direction.y);
+            z.push_back(zLayer);
+
+            tint.push_back(rgba);
+            subject.push_back(jobSubject);
+            type.push_back(jobType);
+            key.push_back(jobKey);
+
+            return (uint32_t)(type.size() - 1);
+        }
+
+        /** Pushes one job per entry of the array, that all share the same type, subject, zLayer, tint and key */
+        void push(uint8_t jobType, uint32_t jobSubject, const TransformArray& trs, float zLayer, uint32_t rgba, uint64_t jobKey) {
+            auto add = [](auto& dst, const auto& src) { dst.insert(dst.end(), src.begin(), src.end()); };
+            size_t n = trs.size();
+
+            add(x, trs.x);
+            add(y, trs.y);
+            add(originX, trs.originX);
+            add(originY, trs.originY);
+            add(scaleX, trs.scaleX);
+            add(scaleY, trs.scaleY);
+            add(cos, trs.cos);
+            add(sin, trs.sin);
+            z.insert(z.end(), n, zLayer);
+
+            tint.insert(tint.end(), n, rgba);
+            subject.insert(subject.end(), n, jobSubject);
+            type.insert(type.end(), n, jobType);
+            key.insert(key.end(), n, jobKey);
+        }
+
+        /** Appends all jobs of another queue (the job numbers of the appended jobs start at the old size()) */
+        void append(const RenderQueue& o) {
+            auto add = [](auto& dst, const auto& src) { dst.insert(dst.end(), src.begin(), src.end()); };
+
+            uint32_t textureBase = (uint32_t)textures.size();
+            size_t first = size();
+
+            add(x, o.x);
+            add(y, o.y);
+            add(originX, o.originX);
+            add(originY, o.originY);
+            add(scaleX, o.scaleX);
+            add(scaleY, o.scaleY);
+            add(cos, o.cos);
+            add(sin, o.sin);
+            add(z, o.z);
+            add(tint, o.tint);
+            add(subject, o.subject);
+            add(type, o.type);
+            add(key, o.key);
+            add(textures, o.textures);
+
+            // Texture jobs point into the textures of their own queue
+            for (size_t i = first; i < type.size(); i++)
+                if (type[i] == TEXTURE) subject[i] += textureBase;
+
+            for (size_t i = 0; i < o.primitiveLayers; i++) {
+                const PrimitiveLayer& src = o.primitives[i];
+                PrimitiveLayer& dst = primitiveLayer(src.z);
+                dst.opaque = dst.opaque && src.opaque;
+                add(dst.vertices, src.vertices);
+            }
+        }
+
+        /** \return - the layer for the zLayer (a new one, if nothing was drawn on it yet) */
+        PrimitiveLayer& primitiveLayer(float zLayer) {
+            // Draw calls tend to stay on the same layer for a while
+            if (lastPrimitiveLayer < primitiveLayers && primitives[lastPrimitiveLayer].z == zLayer)
+                return primitives[lastPrimitiveLayer];
+
+            for (size_t i = 0; i < primitiveLayers; i++) {
+                if (primitives[i].z == zLayer) {
+                    lastPrimitiveLayer = i;
+                    return primitives[i];
+                }
+            }
+
+            if (primitiveLayers == primitives.size()) primitives.emplace_back();
+            PrimitiveLayer& l = primitives[primitiveLayers];
+            l.z = zLayer;
+            l.opaque = true;
+            l.vertices.clear();
+
+            lastPrimitiveLayer = primitiveLayers++;
+            return l;
+        }
+
+        uint32_t pushTexture(const Texture& t, const Transform& tr, float zLayer, uint32_t rgba, uint64_t jobKey) {
+            textures.push_back({t.slot, t.cropSize.x, t.cropSize.y, t.uvOffset.x, t.uvOffset.y});
+            return push(TEXTURE, (uint32_t)(textures.size() - 1), tr, zLayer, rgba, jobKey);
+        }
+
+        /** All jobs reference the same TextureRef */
+        void pushTexture(const Texture& t, const TransformArray& trs, float zLayer, uint32_t rgba, uint64_t jobKey) {
+            textures.push_back({t.slot, t.cropSize.x, t.cropSize.y, t.uvOffset.x, t.uvOffset.y});
+            push(TEXTURE, (uint32_t)(textures.size() - 1), trs, zLayer, rgba, jobKey);
+        }
+    };
+
+}
@@ -0,0 +1,285 @@
+#include "../Engine.h"
+#include "../Transform.h"
+#include "../TransformArray.h"
+
+#include <cmath>
+
+// The widest instruction set, that the compiler was allowed to use (AVX needs -mavx or -march=...)
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TRANSFORMARRAY_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORMARRAY_SSE2
+#endif
+
+namespace RG3GE {
+
+#pragma region Kernels
+    static const float _HALF_PI = 1.57079632679489661923f;
+
+    // Taylor polynomials for -45 to 45 degrees (enough for an error below 1e-6)
+    static const float _S3 = -1.0f / 6.0f, _S5 = 1.0f / 120.0f, _S7 = -1.0f / 5040.0f;
+    static const float _C2 = -1.0f / 2.0f, _C4 = 1.0f / 24.0f, _C6 = -1.0f / 720.0f, _C8 = 1.0f / 40320.0f;
+
+    /**
+     * Same math as the vectorized versions (so every entry gets the same result, no matter where it lands):
+     * degrees -> quarter turns k + rest, the polynomials cover the rest, k picks the quadrant.
+     */
+    static void _sinCosDegrees(float degrees, float& s, float& c) {
+        float r = degrees * (1.0f / 90.0f);
+        float k = std::nearbyint(r);
+        float t = (r - k) * _HALF_PI;
+        float t2 = t * t;
+
+        float ps = t * (1.0f + t2 * (_S3 + t2 * (_S5 + t2 * _S7)));
+        float pc = 1.0f + t2 * (_C2 + t2 * (_C4 + t2 * (_C6 + t2 * _C8)));
+
+        switch ((int)k & 3) {
+            case 0: s = ps;  c = pc;  break;
+            case 1: s = pc;  c = -ps; break;
+            case 2: s = -ps; c = -pc; break;
+            case 3: s = -pc; c = ps;  break;
+        }
+    }
+
+    static float _wrapDegrees(float degrees) {
+        return degrees - 360.0f * std::nearbyint(degrees * (1.0f / 360.0f));
+    }
+
+#if defined(TRANSFORMARRAY_AVX)
+    static const size_t _WIDTH = 8;
+
+    static inline __m256 _wrapDegrees(__m256 d) {
+        __m256 turns = _mm256_round_ps(_mm256_mul_ps(d, _mm256_set1_ps(1.0f / 360.0f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        return _mm256_sub_ps(d, _mm256_mul_ps(turns, _mm256_set1_ps(360.0f)));
+    }
+
+    static void _sinCosDegrees(const float* degrees, float* sinOut, float* cosOut) {
+        __m256 r = _mm256_mul_ps(_mm256_loadu_ps(degrees), _mm256_set1_ps(1.0f / 90.0f));
+        __m256 k = _mm256_round_ps(r, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 t = _mm256_mul_ps(_mm256_sub_ps(r, k), _mm256_set1_ps(_HALF_PI));
+        __m256 t2 = _mm256_mul_ps(t, t);
+
+        __m256 ps = _mm256_add_ps(_mm256_set1_ps(_S5), _mm256_mul_ps(t2, _mm256_set1_ps(_S7)));
+        ps = _mm256_add_ps(_mm256_set1_ps(_S3), _mm256_mul_ps(t2, ps));
+        ps = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(t2, ps));
+        ps = _mm256_mul_ps(t, ps);
+
+        __m256 pc = _mm256_add_ps(_mm256_set1_ps(_C6), _mm256_mul_ps(t2, _mm256_set1_ps(_C8)));
+        pc = _mm256_add_ps(_mm256_set1_ps(_C4), _mm256_mul_ps(t2, pc));
+        pc = _mm256_add_ps(_mm256_set1_ps(_C2), _mm256_mul_ps(t2, pc));
+        pc = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(t2, pc));
+
+        // Quadrant 0 - 3 (AVX has no 256 bit integer math, so it stays in floats)
+        __m256 q = _mm256_sub_ps(k, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(k, _mm256_set1_ps(0.25f))), _mm256_set1_ps(4.0f)));
+        __m256 q1 = _mm256_cmp_ps(q, _mm256_set1_ps(1.0f), _CMP_EQ_OQ);
+        __m256 q2 = _mm256_cmp_ps(q, _mm256_set1_ps(2.0f), _CMP_EQ_OQ);
+        __m256 q3 = _mm256_cmp_ps(q, _mm256_set1_ps(3.0f), _CMP_EQ_OQ);
+        __m256 swap = _mm256_or_ps(q1, q3);
+        __m256 sign = _mm256_set1_ps(-0.0f);
+
+        __m256 s = _mm256_blendv_ps(ps, pc, swap);
+        __m256 c = _mm256_blendv_ps(pc, ps, swap);
+        s = _mm256_xor_ps(s, _mm256_and_ps(_mm256_or_ps(q2, q3), sign));
+        c = _mm256_xor_ps(c, _mm256_and_ps(_mm256_or_ps(q1, q2), sign));
+
+        _mm256_storeu_ps(sinOut, s);
+        _mm256_storeu_ps(cosOut, c);
+    }
+
+    static void _add(float* dst, float v, size_t n) {
+        size_t i = 0;
+        for (__m256 vv = _mm256_set1_ps(v); i + _WIDTH <= n; i += _WIDTH)
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), vv));
+        for (; i < n; i++) dst[i] += v;
+    }
+
+    static void _mul(float* dst, float v, size_t n) {
+        size_t i = 0;
+        for (__m256 vv = _mm256_set1_ps(v); i + _WIDTH <= n; i += _WIDTH)
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), vv));
+        for (; i < n; i++) dst[i] *= v;
+    }
+
+    static void _addScaled(float* dst, const float* src, float factor, size_t n) {
+        size_t i = 0;
+        for (__m256 f = _mm256_set1_ps(factor); i + _WIDTH <= n; i += _WIDTH)
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), f)));
+        for (; i < n; i++) dst[i] += src[i] * factor;
+    }
+
+    static void _addWrapped(float* dst, const float* src, float v, float factor, size_t n) {
+        size_t i = 0;
+        for (__m256 vv = _mm256_set1_ps(v), f = _mm256_set1_ps(factor); i + _WIDTH <= n; i += _WIDTH) {
+            __m256 add = src ? _mm256_mul_ps(_mm256_loadu_ps(src + i), f) : vv;
+            _mm256_storeu_ps(dst + i, _wrapDegrees(_mm256_add_ps(_mm256_loadu_ps(dst + i), add)));
+        }
+        for (; i < n; i++) dst[i] = _wrapDegrees(dst[i] + (src ? src[i] * factor : v));
+    }
+
+#elif defined(TRANSFORMARRAY_SSE2)
+    static const size_t _WIDTH = 4;
+
+    /** Rounds to the nearest integer (only valid below 2^31, which is plenty for degrees) */
+    static inline __m128 _round(__m128 v) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(v)); }
+
+    static inline __m128 _wrapDegrees(__m128 d) {
+        __m128 turns = _round(_mm_mul_ps(d, _mm_set1_ps(1.0f / 360.0f)));
+        return _mm_sub_ps(d, _mm_mul_ps(turns, _mm_set1_ps(360.0f)));
+    }
+
+    static inline __m128 _select(__m128 mask, __m128 a, __m128 b) {  // mask ? a : b
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    static void _sinCosDegrees(const float* degrees, float* sinOut, float* cosOut) {
+        __m128 r = _mm_mul_ps(_mm_loadu_ps(degrees), _mm_set1_ps(1.0f / 90.0f));
+        __m128i ki = _mm_cvtps_epi32(r);
+        __m128 t = _mm_mul_ps(_mm_sub_ps(r, _mm_cvtepi32_ps(ki)), _mm_set1_ps(_HALF_PI));
+        __m128 t2 = _mm_mul_ps(t, t);
+
+        __m128 ps = _mm_add_ps(_mm_set1_ps(_S5), _mm_mul_ps(t2, _mm_set1_ps(_S7)));
+        ps = _mm_add_ps(_mm_set1_ps(_S3), _mm_mul_ps(t2, ps));
+        ps = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(t2, ps));
+        ps = _mm_mul_ps(t, ps);
+
+        __m128 pc = _mm_add_ps(_mm_set1_ps(_C6), _mm_mul_ps(t2, _mm_set1_ps(_C8)));
+        pc = _mm_add_ps(_mm_set1_ps(_C4), _mm_mul_ps(t2, pc));
+        pc = _mm_add_ps(_mm_set1_ps(_C2), _mm_mul_ps(t2, pc));
+        pc = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(t2, pc));
+
+        // Bit 0 of the quadrant swaps sin and cos, the sign flips follow from bit 1
+        __m128i q = _mm_and_si128(ki, _mm_set1_epi32(3));
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+        __m128 sinNeg = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(q, 1), 31));
+        __m128 cosNeg = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(_mm_add_epi32(q, _mm_set1_epi32(1)), 1), 31));
+
+        __m128 s = _mm_xor_ps(_select(swap, pc, ps), sinNeg);
+        __m128 c = _mm_xor_ps(_select(swap, ps, pc), _mm_and_ps(cosNeg, _mm_set1_ps(-0.0f)));
+
+        _mm_storeu_ps(sinOut, s);
+        _mm_storeu_ps(cosOut, c);
+    }
+
+    static void _add(float* dst, float v, size_t n) {
+        size_t i = 0;
+        for (__m128 vv = _mm_set1_ps(v); i + _WIDTH <= n; i += _WIDTH)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), vv));
+        for (; i < n; i++) dst[i] += v;
+    }
+
+    static void _mul(float* dst, float v, size_t n) {
+        size_t i = 0;
+        for (__m128 vv = _mm_set1_ps(v); i + _WIDTH <= n; i += _WIDTH)
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), vv));
+        for (; i < n; i++) dst[i] *= v;
+    }
+
+    static void _addScaled(float* dst, const float* src, float factor, size_t n) {
+        size_t i = 0;
+        for (__m128 f = _mm_set1_ps(factor); i + _WIDTH <= n; i += _WIDTH)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), f)));
+        for (; i < n; i++) dst[i] += src[i] * factor;
+    }
+
+    static void _addWrapped(float* dst, const float* src, float v, float factor, size_t n) {
+        size_t i = 0;
+        for (__m128 vv = _mm_set1_ps(v), f = _mm_set1_ps(factor); i + _WIDTH <= n; i += _WIDTH) {
+            __m128 add = src ? _mm_mul_ps(_mm_loadu_ps(src + i), f) : vv;
+            _mm_storeu_ps(dst + i, _wrapDegrees(_mm_add_ps(_mm_loadu_ps(dst + i), add)));
+        }
+        for (; i < n; i++) dst[i] = _wrapDegrees(dst[i] + (src ? src[i] * factor : v));
+    }
+
+#else
+    static const size_t _WIDTH = 1;
+
+    static void _sinCosDegrees(const float* degrees, float* sinOut, float* cosOut) {
+        _sinCosDegrees(degrees[0], sinOut[0], cosOut[0]);
+    }
+
+    static void _add(float* dst, float v, size_t n) {
+        for (size_t i = 0; i < n; i++) dst[i] += v;
+    }
+
+    static void _mul(float* dst, float v, size_t n) {
+        for (size_t i = 0; i < n; i++) dst[i] *= v;
+    }
+
+    static void _addScaled(float* dst, const float* src, float factor, size_t n) {
+        for (size_t i = 0; i < n; i++) dst[i] += src[i] * factor;
+    }
+
+    static void _addWrapped(float* dst, const float* src, float v, float factor, size_t n) {
+        for (size_t i = 0; i < n; i++) dst[i] = _wrapDegrees(dst[i] + (src ? src[i] * factor : v));
+    }
+#endif
+#pragma endregion
+
+#pragma region TransformArray
+    void TransformArray::reserve(size_t n) {
+        for (auto v : {&x, &y, &originX, &originY, &scaleX, &scaleY, &rotation, &cos, &sin}) v->reserve(n);
+    }
+
+    void TransformArray::clear() {
+        for (auto v : {&x, &y, &originX, &originY, &scaleX, &scaleY, &rotation, &cos, &sin}) v->clear();
+    }
+
+    size_t TransformArray::add(const Transform& tr) {
+        for (auto v : {&x, &y, &originX, &originY, &scaleX, &scaleY, &rotation, &cos, &sin}) v->emplace_back();
+        set(size() - 1, tr);
+        return size() - 1;
+    }
+
+    void TransformArray::set(size_t i, const Transform& tr) {
+        x[i] = tr.position.x;
+        y[i] = tr.position.y;
+        originX[i] = tr.origin.x;
+        originY[i] = tr.origin.y;
+        scaleX[i] = tr.scale.x;
+        scaleY[i] = tr.scale.y;
+        rotation[i] = _wrapDegrees((float)(tr.rotation.angle * 360.0 / PI2));
+        cos[i] = (float)tr.rotation.direction.x;
+        sin[i] = (float)tr.rotation.direction.y;
+    }
+
+    Transform TransformArray::get(size_t i) const {
+        Transform tr = {{x[i], y[i]}, {originX[i], originY[i]}, {scaleX[i], scaleY[i]}, Angle(rotation[i])};
+        tr.rotation.direction = {(double)cos[i], (double)sin[i]};  // keep what would be drawn
+        return tr;
+    }
+
+    void TransformArray::translate(float dx, float dy) {
+        _add(x.data(), dx, size());
+        _add(y.data(), dy, size());
+    }
+
+    void TransformArray::translate(const float* dx, const float* dy, float factor) {
+        _addScaled(x.data(), dx, factor, size());
+        _addScaled(y.data(), dy, factor, size());
+    }
+
+    void TransformArray::rotate(float degrees) {
+        _addWrapped(rotation.data(), nullptr, degrees, 1.0f, size());
+    }
+
+    void TransformArray::rotate(const float* degrees, float factor) {
+        _addWrapped(rotation.data(), degrees, 0.0f, factor, size());
+    }
+
+    void TransformArray::scale(float sx, float sy) {
+        _mul(scaleX.data(), sx, size());
+        _mul(scaleY.data(), sy, size());
+    }
+
+    void TransformArray::updateDirections() {
+        size_t n = size(), i = 0;
+        for (; i + _WIDTH <= n; i += _WIDTH)
+            _sinCosDegrees(rotation.data() + i, sin.data() + i, cos.data() + i);
+        for (; i < n; i++)
+            _sinCosDegrees(rotation[i], sin[i], cos[i]);
+    }
+#pragma endregion
+
+}
@@ -0,0 +1,45 @@
+#include "./WorkerPool.h"
+#include "../Macros.h"
+
+namespace RG3GE::Core {
+
+    void WorkerPool::submit(std::function<void()> job, int threads) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = false;
+        _jobs.push_back(std::move(job));
+
+        while ((int)_threads.size() < threads)
+            _threads.emplace_back(&WorkerPool::_work, this);
+
+        _cv.notify_one();
+    }
+
+    void WorkerPool::stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+            _jobs.clear();
+            _cv.notify_all();
+        }
+
+        for (auto& t : _threads) t.join();
+        _threads.clear();
+    }
+
+    void WorkerPool::_work() {
+        ProfileThreadName("Worker");
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _cv.wait(lock, [this] { return _stop || !_jobs.empty(); });
+            if (_stop) break;
+
+            auto job = std::move(_jobs.front());
+            _jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * A few threads, that run jobs in the order they were submitted.
+     * The threads are only started by the first submit().
+     */
+    class WorkerPool {
+    public:
+        ~WorkerPool() { stop(); }
+
+        void submit(std::function<void()> job, int threads);
+
+        /** Jobs, that have not started yet, are dropped. Waits for the running ones */
+        void stop();
+
+    private:
+        void _work();
+
+        std::vector<std::thread> _threads;
+        std::deque<std::function<void()>> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        bool _stop = false;
+    };
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+namespace RG3GE::Core {
+
+    /**
+     * Thin layer between the engine and OpenGL, that remembers what is currently bound / set
+     * and skips every call, that would not change anything.
+     *
+     * Everything the engine binds has to go through here, otherwise the cache goes stale.
+     * (call invalidate() after talking to OpenGL directly)
+     */
+    class GLState {
+    public:
+        /** Number of calls, that were actually sent to the driver / that were skipped */
+        unsigned int calls = 0;
+        unsigned int skipped = 0;
+
+        /** Part of calls, that were texture binds / uniform updates (for the frame statistics) */
+        unsigned int textureBinds = 0;
+        unsigned int uniformUpdates = 0;
+
+        /** Forgets everything, that is known about the current state */
+        void invalidate() {
+            program = UNKNOWN;
+            vertexArray = UNKNOWN;
+            arrayBuffer = UNKNOWN;
+            texture = UNKNOWN;
+            blend = UNKNOWN;
+            uniforms.clear();
+        }
+
+        void useProgram(unsigned int p) {
+            if (p == program) { skipped++; return; }
+            glUseProgram(p);
+            program = p;
+            uniforms.clear();
+            calls++;
+        }
+
+        void bindVertexArray(unsigned int vao) {
+            if (vao == vertexArray) { skipped++; return; }
+            glBindVertexArray(vao);
+            vertexArray = vao;
+            calls++;
+        }
+
+        void bindArrayBuffer(unsigned int buffer) {
+            if (buffer == arrayBuffer) { skipped++; return; }
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            arrayBuffer = buffer;
+            calls++;
+        }
+
+        /** Binds to GL_TEXTURE_2D of texture unit 0 (the only one the engine uses) */
+        void bindTexture(unsigned int tex) {
+            if (tex == texture) { skipped++; return; }
+            glBindTexture(GL_TEXTURE_2D, tex);
+            texture = tex;
+            textureBinds++;
+            calls++;
+        }
+
+        void enableBlend(bool enable) {
+            if (blend == (unsigned int)enable) { skipped++; return; }
+            if (enable)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+            blend = enable;
+            calls++;
+        }
+
+        /** Has to be called, when the objects get deleted (OpenGL falls back to 0 for bound objects, that are deleted) */
+        void forgetVertexArray(unsigned int vao) { if (vao == vertexArray) vertexArray = 0; }
+        void forgetBuffer(unsigned int buffer) { if (buffer == arrayBuffer) arrayBuffer = 0; }
+        void forgetTexture(unsigned int tex) { if (tex == texture) texture = 0; }
+
+        void uniform1i(int loc, int v) {
+            if (same(loc, (float)v, 0, 0, 0)) return;
+            glUniform1i(loc, v);
+        }
+        void uniform1f(int loc, float v) {
+            if (same(loc, v, 0, 0, 0)) return;
+            glUniform1f(loc, v);
+        }
+        void uniform2f(int loc, float x, float y) {
+            if (same(loc, x, y, 0, 0)) return;
+            glUniform2f(loc, x, y);
+        }
+        void uniform4f(int loc, float x, float y, float z, float w) {
+            if (same(loc, x, y, z, w)) return;
+            glUniform4f(loc, x, y, z, w);
+        }
+
+    private:
+        struct UniformValue {
+            bool set = false;
+            float v[4];
+        };
+
+        static const unsigned int UNKNOWN = ~0u;
+
+        unsigned int program = UNKNOWN;
+        unsigned int vertexArray = UNKNOWN;
+        unsigned int arrayBuffer = UNKNOWN;
+        unsigned int texture = UNKNOWN;
+        unsigned int blend = UNKNOWN;
+
+        std::vector<UniformValue> uniforms; // indexed by the uniform location of the current program
+
+        /** \return - true if the uniform already has the value (otherwise the value is stored as the new one) */
+        bool same(int loc, float x, float y, float z, float w) {
+            if (loc < 0) { skipped++; return true; }
+            if ((size_t)loc >= uniforms.size()) uniforms.resize(loc + 1);
+
+            UniformValue& u = uniforms[loc];
+            if (u.set && u.v[0] == x && u.v[1] == y && u.v[2] == z && u.v[3] == w) {
+                skipped++;
+                return true;
+            }
+
+            u.set = true;
+            u.v[0] = x;
+            u.v[1] = y;
+            u.v[2] = z;
+            u.v[3] = w;
+            uniformUpdates++;
+            calls++;
+            return false;
+        }
+    };
+
+}
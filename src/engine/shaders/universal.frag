@@ -7,10 +7,9 @@
 uniform int u_shader_mode;
 
 //=============================================================================
-// Colors
+// Texture
 //-----------------------------------------------------------------------------
 //=============================================================================
-uniform vec4 u_drawcolor;
 uniform sampler2D u_texture;
 
 //=============================================================================
@@ -18,19 +17,22 @@ uniform sampler2D u_texture;
 //-----------------------------------------------------------------------------
 //=============================================================================
 in vec4 vertcolor;
+in vec4 drawcolor;
 in vec2 uvs;
 
+out vec4 fragColor;
+
 void main() {
     switch(u_shader_mode) {
         case 0: /* Shape2D */
-	        gl_FragColor = vertcolor;
+	        fragColor = vertcolor;
             break;
 
         case 1: /* Texture */
-	        gl_FragColor = texture(u_texture, uvs);
+	        fragColor = texture(u_texture, uvs);
             break;
     }
 
-    gl_FragColor *= u_drawcolor;
+    fragColor *= drawcolor;
 };
 
@@ -1,7 +1,6 @@
 std::string universal_vs = 
 "#version 330 core\n"
 "\n"
-"\n"
 "//=============================================================================\n"
 "// Shader Mode\n"
 "//-----------------------------------------------------------------------------\n"
@@ -17,14 +16,15 @@ std::string universal_vs =
 "//=============================================================================\n"
 "// Transform\n"
 "//-----------------------------------------------------------------------------\n"
+"// One entry (5 texels) per job of the frame, in the order they are drawn\n"
+"//   0: translation.xy angle.xy\n"
+"//   1: origin.xy      scale.xy\n"
+"//   2: textureCrop (size.xy offset.xy)\n"
+"//   3: tint\n"
+"//   4: zlayer\n"
 "//=============================================================================\n"
-"uniform vec2    u_translation;\n"
-"uniform vec2    u_origin;\n"
-"uniform float   u_zlayer;\n"
-"uniform vec2    u_angle;\n"
-"uniform vec2    u_scale;\n"
-"\n"
-"uniform vec4    u_textureCrop;\n"
+"uniform samplerBuffer u_transforms;\n"
+"uniform int     u_job;  // entry of the job (or the first instance)\n"
 "\n"
 "//=============================================================================\n"
 "// Vector2D Attributes\n"
@@ -39,34 +39,45 @@ std::string universal_vs =
 "//-----------------------------------------------------------------------------\n"
 "//=============================================================================\n"
 "out vec4 vertcolor;\n"
+"out vec4 drawcolor;\n"
 "out vec2 uvs;\n"
 "\n"
 "void main() {\n"
 "    vec2 finalOrig;\n"
+"    vec2 finalPos;\n"
+"\n"
+"    // Instanced draws use consecutive entries\n"
+"    int entry = (u_job + gl_InstanceID) * 5;\n"
+"    vec4 translationAngle = texelFetch(u_transforms, entry + 0);\n"
+"    vec4 originScale = texelFetch(u_transforms, entry + 1);\n"
+"    vec4 textureCrop = texelFetch(u_transforms, entry + 2);\n"
+"    drawcolor = texelFetch(u_transforms, entry + 3);\n"
+"    float zlayer = texelFetch(u_transforms, entry + 4).x;\n"
+"\n"
 "    switch(u_shader_mode) {\n"
 "        case 0: /* Shape 2D */\n"
 "            vertcolor = a_color;\n"
-"            finalOrig = a_position - u_origin;\n"
+"            finalOrig = a_position - originScale.xy;\n"
 "            break;\n"
 "\n"
 "        case 1: /* Texture */\n"
-"            uvs = ( a_uvCoords * u_textureCrop.xy )\n"
-"                     + u_textureCrop.zw;\n"
-"            finalOrig = (a_position * u_textureCrop.xy) - u_origin;\n"
+"            uvs = ( a_uvCoords * textureCrop.xy )\n"
+"                     + textureCrop.zw;\n"
+"            finalOrig = (a_position * textureCrop.xy) - originScale.xy;\n"
 "            break;\n"
 "    }\n"
 "\n"
-"    finalOrig *= u_scale;\n"
-"\n"
-"    vec2 finalPos = vec2( \n"
-"        finalOrig.x * u_angle.x + finalOrig.y * (-u_angle.y), \n"
-"        finalOrig.x * u_angle.y + finalOrig.y *   u_angle.x\n"
-"    ) + u_translation;\n"
+"    vec2 angle = translationAngle.zw;\n"
+"    finalOrig *= originScale.zw;\n"
 "\n"
+"    finalPos = vec2( \n"
+"        finalOrig.x * angle.x + finalOrig.y * (-angle.y), \n"
+"        finalOrig.x * angle.y + finalOrig.y *   angle.x\n"
+"    ) + translationAngle.xy;\n"
 "\n"
 "    gl_Position = vec4( \n"
 "            ((finalPos / u_screen) * vec2(1, -1)) + vec2(-1, 1)\n"
-"            , u_zlayer , 1);\n"
+"            , zlayer , 1);\n"
 "}\n"
 ;
 
@@ -81,10 +92,9 @@ std::string universal_fs =
 "uniform int u_shader_mode;\n"
 "\n"
 "//=============================================================================\n"
-"// Colors\n"
+"// Texture\n"
 "//-----------------------------------------------------------------------------\n"
 "//=============================================================================\n"
-"uniform vec4 u_drawcolor;\n"
 "uniform sampler2D u_texture;\n"
 "\n"
 "//=============================================================================\n"
@@ -92,20 +102,23 @@ std::string universal_fs =
 "//-----------------------------------------------------------------------------\n"
 "//=============================================================================\n"
 "in vec4 vertcolor;\n"
+"in vec4 drawcolor;\n"
 "in vec2 uvs;\n"
 "\n"
+"out vec4 fragColor;\n"
+"\n"
 "void main() {\n"
 "    switch(u_shader_mode) {\n"
 "        case 0: /* Shape2D */\n"
-"	        gl_FragColor = vertcolor;\n"
+"	        fragColor = vertcolor;\n"
 "            break;\n"
 "\n"
 "        case 1: /* Texture */\n"
-"	        gl_FragColor = texture(u_texture, uvs);\n"
+"	        fragColor = texture(u_texture, uvs);\n"
 "            break;\n"
 "    }\n"
 "\n"
-"    gl_FragColor *= u_drawcolor;\n"
+"    fragColor *= drawcolor;\n"
 "};\n"
 "\n"
 ;
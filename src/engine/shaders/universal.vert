@@ -15,14 +15,15 @@ uniform vec2 u_screen;
 //=============================================================================
 // Transform
 //-----------------------------------------------------------------------------
+// One entry (5 texels) per job of the frame, in the order they are drawn
+//   0: translation.xy angle.xy
+//   1: origin.xy      scale.xy
+//   2: textureCrop (size.xy offset.xy)
+//   3: tint
+//   4: zlayer
 //=============================================================================
-uniform vec2    u_translation;
-uniform vec2    u_origin;
-uniform float   u_zlayer;
-uniform vec2    u_angle;
-uniform vec2    u_scale;
-
-uniform vec4    u_textureCrop;
+uniform samplerBuffer u_transforms;
+uniform int     u_job;  // entry of the job (or the first instance)
 
 //=============================================================================
 // Vector2D Attributes
@@ -37,32 +38,43 @@ in vec2 a_uvCoords;
 //-----------------------------------------------------------------------------
 //=============================================================================
 out vec4 vertcolor;
+out vec4 drawcolor;
 out vec2 uvs;
 
 void main() {
     vec2 finalOrig;
+    vec2 finalPos;
+
+    // Instanced draws use consecutive entries
+    int entry = (u_job + gl_InstanceID) * 5;
+    vec4 translationAngle = texelFetch(u_transforms, entry + 0);
+    vec4 originScale = texelFetch(u_transforms, entry + 1);
+    vec4 textureCrop = texelFetch(u_transforms, entry + 2);
+    drawcolor = texelFetch(u_transforms, entry + 3);
+    float zlayer = texelFetch(u_transforms, entry + 4).x;
+
     switch(u_shader_mode) {
         case 0: /* Shape 2D */
             vertcolor = a_color;
-            finalOrig = a_position - u_origin;
+            finalOrig = a_position - originScale.xy;
             break;
 
         case 1: /* Texture */
-            uvs = ( a_uvCoords * u_textureCrop.xy )
-                     + u_textureCrop.zw;
-            finalOrig = (a_position * u_textureCrop.xy) - u_origin;
+            uvs = ( a_uvCoords * textureCrop.xy )
+                     + textureCrop.zw;
+            finalOrig = (a_position * textureCrop.xy) - originScale.xy;
             break;
     }
 
-    finalOrig *= u_scale;
-
-    vec2 finalPos = vec2( 
-        finalOrig.x * u_angle.x + finalOrig.y * (-u_angle.y), 
-        finalOrig.x * u_angle.y + finalOrig.y *   u_angle.x
-    ) + u_translation;
+    vec2 angle = translationAngle.zw;
+    finalOrig *= originScale.zw;
 
+    finalPos = vec2( 
+        finalOrig.x * angle.x + finalOrig.y * (-angle.y), 
+        finalOrig.x * angle.y + finalOrig.y *   angle.x
+    ) + translationAngle.xy;
 
     gl_Position = vec4( 
             ((finalPos / u_screen) * vec2(1, -1)) + vec2(-1, 1)
-            , u_zlayer , 1);
+            , zlayer , 1);
 }
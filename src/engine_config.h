@@ -1,7 +1,37 @@
-// Defines how many Times you can use Engine::TextureLoad, before you have to make room to load new textures
-// Textures created via TextureClone are not part of this cap
+// Defines how many textures can be loaded via Engine::TextureLoad, before the Engine has to allocate more memory
+// Textures created via TextureClone are not part of this count
 #define ENGINE_TEXTURE_LIMIT 512
 
 // Defines how many DrawCalls/Objects can be created, before the Engine has allocate more memory (sloooowwwwww) 
 // DrawCalls are created by all SubmitForRender-Functions, as well as all "Draw..." functions 
 #define ENGINE_DRAW_CALL_LIMIT 2048
+
+// Textures loaded via Engine::TextureLoad, that are not wider or higher than this, are packed into shared atlas pages.
+// That way sprites from different files can be drawn in the same batch. (0 = every texture gets its own OpenGL texture)
+#define ENGINE_ATLAS_MAX_IMAGE_SIZE 256
+
+// Width and height of one atlas page in pixels (0 = disables the atlas)
+#define ENGINE_ATLAS_PAGE_SIZE 2048
+
+// Textures, whose last handle was destroyed, stay cached (a new TextureLoad of the file is free),
+// until they take more than this many bytes of VRAM. The least recently loaded ones are freed first.
+// 0 = textures are freed with their last handle (handles, that exist at the same time, still share one texture)
+#define ENGINE_TEXTURE_CACHE_BYTES (32 * 1024 * 1024)
+
+// Threads, that decode the files of Engine::TextureLoadAsync
+#define ENGINE_TEXTURE_LOAD_THREADS 2
+
+// Bytes of pixels, that Engine::TextureLoadAsync copies to VRAM per frame (at least one row per texture)
+#define ENGINE_TEXTURE_UPLOAD_BYTES (4 * 1024 * 1024)
+
+// Color of textures, that are still loading (RGBA8, r in the lowest byte)
+#define ENGINE_TEXTURE_PLACEHOLDER_COLOR 0x80808080
+
+// Number of vertices one shared vertex buffer can hold. Shape2Ds are placed inside these buffers,
+// shapes with more vertices than this get a buffer of their own.
+#define ENGINE_GEOMETRY_HEAP_VERTICES 65536
+
+// Number of zones, that the profiler remembers per thread (older ones get overwritten)
+// The profiler is only compiled into debug builds, unless ENGINE_PROFILE is defined
+#define ENGINE_PROFILE_EVENTS 16384
+// #define ENGINE_PROFILE